@@ -21,6 +21,25 @@ BEGIN_RCPP
     return __sexp_result;
 END_RCPP
 }
+// boot_adj_areas
+arma::mat boot_adj_areas(arma::mat& ct, arma::vec& pop, int n_boot, double seed, int n_threads = 0);
+RcppExport SEXP teamlucc_boot_adj_areas(SEXP ctSEXP, SEXP popSEXP, SEXP n_bootSEXP, SEXP seedSEXP, SEXP n_threadsSEXP) {
+BEGIN_RCPP
+    SEXP __sexp_result;
+    {
+        Rcpp::RNGScope __rngScope;
+        Rcpp::traits::input_parameter< arma::mat& >::type ct(ctSEXP );
+        Rcpp::traits::input_parameter< arma::vec& >::type pop(popSEXP );
+        Rcpp::traits::input_parameter< int >::type n_boot(n_bootSEXP );
+        Rcpp::traits::input_parameter< double >::type seed(seedSEXP );
+        Rcpp::traits::input_parameter< int >::type n_threads(n_threadsSEXP );
+        arma::mat __result = boot_adj_areas(ct, pop, n_boot, seed, n_threads);
+        PROTECT(__sexp_result = Rcpp::wrap(__result));
+    }
+    UNPROTECT(1);
+    return __sexp_result;
+END_RCPP
+}
 // calc_chg_dir
 arma::ivec calc_chg_dir(arma::mat t1p, arma::mat t2p);
 RcppExport SEXP teamlucc_calc_chg_dir(SEXP t1pSEXP, SEXP t2pSEXP) {
@@ -37,6 +56,91 @@ BEGIN_RCPP
     return __sexp_result;
 END_RCPP
 }
+// calc_chg_mag
+arma::vec calc_chg_mag(arma::mat& t1p, arma::mat& t2p, double scale = 1);
+RcppExport SEXP teamlucc_calc_chg_mag(SEXP t1pSEXP, SEXP t2pSEXP, SEXP scaleSEXP) {
+BEGIN_RCPP
+    SEXP __sexp_result;
+    {
+        Rcpp::RNGScope __rngScope;
+        Rcpp::traits::input_parameter< arma::mat& >::type t1p(t1pSEXP );
+        Rcpp::traits::input_parameter< arma::mat& >::type t2p(t2pSEXP );
+        Rcpp::traits::input_parameter< double >::type scale(scaleSEXP );
+        arma::vec __result = calc_chg_mag(t1p, t2p, scale);
+        PROTECT(__sexp_result = Rcpp::wrap(__result));
+    }
+    UNPROTECT(1);
+    return __sexp_result;
+END_RCPP
+}
+// calc_max_class
+Rcpp::NumericVector calc_max_class(arma::mat& probs);
+RcppExport SEXP teamlucc_calc_max_class(SEXP probsSEXP) {
+BEGIN_RCPP
+    SEXP __sexp_result;
+    {
+        Rcpp::RNGScope __rngScope;
+        Rcpp::traits::input_parameter< arma::mat& >::type probs(probsSEXP );
+        Rcpp::NumericVector __result = calc_max_class(probs);
+        PROTECT(__sexp_result = Rcpp::wrap(__result));
+    }
+    UNPROTECT(1);
+    return __sexp_result;
+END_RCPP
+}
+// accum_class_freq
+arma::vec accum_class_freq(arma::vec freqs, arma::vec& classes, int n_threads = 0);
+RcppExport SEXP teamlucc_accum_class_freq(SEXP freqsSEXP, SEXP classesSEXP, SEXP n_threadsSEXP) {
+BEGIN_RCPP
+    SEXP __sexp_result;
+    {
+        Rcpp::RNGScope __rngScope;
+        Rcpp::traits::input_parameter< arma::vec >::type freqs(freqsSEXP );
+        Rcpp::traits::input_parameter< arma::vec& >::type classes(classesSEXP );
+        Rcpp::traits::input_parameter< int >::type n_threads(n_threadsSEXP );
+        arma::vec __result = accum_class_freq(freqs, classes, n_threads);
+        PROTECT(__sexp_result = Rcpp::wrap(__result));
+    }
+    UNPROTECT(1);
+    return __sexp_result;
+END_RCPP
+}
+// calc_ct
+arma::mat calc_ct(arma::vec& predicted, arma::vec& observed, int n_predicted, int n_observed);
+RcppExport SEXP teamlucc_calc_ct(SEXP predictedSEXP, SEXP observedSEXP, SEXP n_predictedSEXP, SEXP n_observedSEXP) {
+BEGIN_RCPP
+    SEXP __sexp_result;
+    {
+        Rcpp::RNGScope __rngScope;
+        Rcpp::traits::input_parameter< arma::vec& >::type predicted(predictedSEXP );
+        Rcpp::traits::input_parameter< arma::vec& >::type observed(observedSEXP );
+        Rcpp::traits::input_parameter< int >::type n_predicted(n_predictedSEXP );
+        Rcpp::traits::input_parameter< int >::type n_observed(n_observedSEXP );
+        arma::mat __result = calc_ct(predicted, observed, n_predicted, n_observed);
+        PROTECT(__sexp_result = Rcpp::wrap(__result));
+    }
+    UNPROTECT(1);
+    return __sexp_result;
+END_RCPP
+}
+// accum_class_stats
+arma::mat accum_class_stats(arma::mat stats, arma::mat& x, arma::vec& classes, int n_threads = 0);
+RcppExport SEXP teamlucc_accum_class_stats(SEXP statsSEXP, SEXP xSEXP, SEXP classesSEXP, SEXP n_threadsSEXP) {
+BEGIN_RCPP
+    SEXP __sexp_result;
+    {
+        Rcpp::RNGScope __rngScope;
+        Rcpp::traits::input_parameter< arma::mat >::type stats(statsSEXP );
+        Rcpp::traits::input_parameter< arma::mat& >::type x(xSEXP );
+        Rcpp::traits::input_parameter< arma::vec& >::type classes(classesSEXP );
+        Rcpp::traits::input_parameter< int >::type n_threads(n_threadsSEXP );
+        arma::mat __result = accum_class_stats(stats, x, classes, n_threads);
+        PROTECT(__sexp_result = Rcpp::wrap(__result));
+    }
+    UNPROTECT(1);
+    return __sexp_result;
+END_RCPP
+}
 // cloud_fill
 arma::mat cloud_fill(arma::mat cloudy, arma::mat& clear, arma::ivec& cloud_mask, arma::ivec dims, int num_class, int min_pixel, int max_pixel, int cloud_nbh, int DN_min, int DN_max, bool verbose = false);
 RcppExport SEXP teamlucc_cloud_fill(SEXP cloudySEXP, SEXP clearSEXP, SEXP cloud_maskSEXP, SEXP dimsSEXP, SEXP num_classSEXP, SEXP min_pixelSEXP, SEXP max_pixelSEXP, SEXP cloud_nbhSEXP, SEXP DN_minSEXP, SEXP DN_maxSEXP, SEXP verboseSEXP) {
@@ -85,3 +189,660 @@ BEGIN_RCPP
     return __sexp_result;
 END_RCPP
 }
+// composite_block
+arma::mat composite_block(arma::mat& vals, arma::mat& codes, arma::vec date_scores, int red_band = 0, int nir_band = 0, double w_ndvi = 0, double w_brightness = 0, double scale = 10000, int n_threads = 0);
+RcppExport SEXP teamlucc_composite_block(SEXP valsSEXP, SEXP codesSEXP, SEXP date_scoresSEXP, SEXP red_bandSEXP, SEXP nir_bandSEXP, SEXP w_ndviSEXP, SEXP w_brightnessSEXP, SEXP scaleSEXP, SEXP n_threadsSEXP) {
+BEGIN_RCPP
+    SEXP __sexp_result;
+    {
+        Rcpp::RNGScope __rngScope;
+        Rcpp::traits::input_parameter< arma::mat& >::type vals(valsSEXP );
+        Rcpp::traits::input_parameter< arma::mat& >::type codes(codesSEXP );
+        Rcpp::traits::input_parameter< arma::vec >::type date_scores(date_scoresSEXP );
+        Rcpp::traits::input_parameter< int >::type red_band(red_bandSEXP );
+        Rcpp::traits::input_parameter< int >::type nir_band(nir_bandSEXP );
+        Rcpp::traits::input_parameter< double >::type w_ndvi(w_ndviSEXP );
+        Rcpp::traits::input_parameter< double >::type w_brightness(w_brightnessSEXP );
+        Rcpp::traits::input_parameter< double >::type scale(scaleSEXP );
+        Rcpp::traits::input_parameter< int >::type n_threads(n_threadsSEXP );
+        arma::mat __result = composite_block(vals, codes, date_scores, red_band, nir_band, w_ndvi, w_brightness, scale, n_threads);
+        PROTECT(__sexp_result = Rcpp::wrap(__result));
+    }
+    UNPROTECT(1);
+    return __sexp_result;
+END_RCPP
+}
+// gridsample_cells
+Rcpp::NumericVector gridsample_cells(double nrows, double ncols, arma::vec& row_start, arma::vec& row_end, arma::vec& col_start, arma::vec& col_end, int nsamp, bool rowmajor = false, bool replace = false);
+RcppExport SEXP teamlucc_gridsample_cells(SEXP nrowsSEXP, SEXP ncolsSEXP, SEXP row_startSEXP, SEXP row_endSEXP, SEXP col_startSEXP, SEXP col_endSEXP, SEXP nsampSEXP, SEXP rowmajorSEXP, SEXP replaceSEXP) {
+BEGIN_RCPP
+    SEXP __sexp_result;
+    {
+        Rcpp::RNGScope __rngScope;
+        Rcpp::traits::input_parameter< double >::type nrows(nrowsSEXP );
+        Rcpp::traits::input_parameter< double >::type ncols(ncolsSEXP );
+        Rcpp::traits::input_parameter< arma::vec& >::type row_start(row_startSEXP );
+        Rcpp::traits::input_parameter< arma::vec& >::type row_end(row_endSEXP );
+        Rcpp::traits::input_parameter< arma::vec& >::type col_start(col_startSEXP );
+        Rcpp::traits::input_parameter< arma::vec& >::type col_end(col_endSEXP );
+        Rcpp::traits::input_parameter< int >::type nsamp(nsampSEXP );
+        Rcpp::traits::input_parameter< bool >::type rowmajor(rowmajorSEXP );
+        Rcpp::traits::input_parameter< bool >::type replace(replaceSEXP );
+        Rcpp::NumericVector __result = gridsample_cells(nrows, ncols, row_start, row_end, col_start, col_end, nsamp, rowmajor, replace);
+        PROTECT(__sexp_result = Rcpp::wrap(__result));
+    }
+    UNPROTECT(1);
+    return __sexp_result;
+END_RCPP
+}
+// accum_grts_counts
+Rcpp::List accum_grts_counts(Rcpp::List counts, arma::vec& strata, double first_row, int n_cols, int n_levels, double seed, int n_threads = 0);
+RcppExport SEXP teamlucc_accum_grts_counts(SEXP countsSEXP, SEXP strataSEXP, SEXP first_rowSEXP, SEXP n_colsSEXP, SEXP n_levelsSEXP, SEXP seedSEXP, SEXP n_threadsSEXP) {
+BEGIN_RCPP
+    SEXP __sexp_result;
+    {
+        Rcpp::RNGScope __rngScope;
+        Rcpp::traits::input_parameter< Rcpp::List >::type counts(countsSEXP );
+        Rcpp::traits::input_parameter< arma::vec& >::type strata(strataSEXP );
+        Rcpp::traits::input_parameter< double >::type first_row(first_rowSEXP );
+        Rcpp::traits::input_parameter< int >::type n_cols(n_colsSEXP );
+        Rcpp::traits::input_parameter< int >::type n_levels(n_levelsSEXP );
+        Rcpp::traits::input_parameter< double >::type seed(seedSEXP );
+        Rcpp::traits::input_parameter< int >::type n_threads(n_threadsSEXP );
+        Rcpp::List __result = accum_grts_counts(counts, strata, first_row, n_cols, n_levels, seed, n_threads);
+        PROTECT(__sexp_result = Rcpp::wrap(__result));
+    }
+    UNPROTECT(1);
+    return __sexp_result;
+END_RCPP
+}
+// grts_collect
+arma::mat grts_collect(arma::vec& strata, double first_row, int n_cols, int n_levels, double seed, arma::vec& strata_vals, arma::vec& buckets, int n_threads = 0);
+RcppExport SEXP teamlucc_grts_collect(SEXP strataSEXP, SEXP first_rowSEXP, SEXP n_colsSEXP, SEXP n_levelsSEXP, SEXP seedSEXP, SEXP strata_valsSEXP, SEXP bucketsSEXP, SEXP n_threadsSEXP) {
+BEGIN_RCPP
+    SEXP __sexp_result;
+    {
+        Rcpp::RNGScope __rngScope;
+        Rcpp::traits::input_parameter< arma::vec& >::type strata(strataSEXP );
+        Rcpp::traits::input_parameter< double >::type first_row(first_rowSEXP );
+        Rcpp::traits::input_parameter< int >::type n_cols(n_colsSEXP );
+        Rcpp::traits::input_parameter< int >::type n_levels(n_levelsSEXP );
+        Rcpp::traits::input_parameter< double >::type seed(seedSEXP );
+        Rcpp::traits::input_parameter< arma::vec& >::type strata_vals(strata_valsSEXP );
+        Rcpp::traits::input_parameter< arma::vec& >::type buckets(bucketsSEXP );
+        Rcpp::traits::input_parameter< int >::type n_threads(n_threadsSEXP );
+        arma::mat __result = grts_collect(strata, first_row, n_cols, n_levels, seed, strata_vals, buckets, n_threads);
+        PROTECT(__sexp_result = Rcpp::wrap(__result));
+    }
+    UNPROTECT(1);
+    return __sexp_result;
+END_RCPP
+}
+// buffer_mask_block
+Rcpp::NumericVector buffer_mask_block(arma::vec& x, int n_rows, int n_cols, int first_row, int n_out_rows, double radius, double foreground = 1, double background = 0, int n_threads = 0);
+RcppExport SEXP teamlucc_buffer_mask_block(SEXP xSEXP, SEXP n_rowsSEXP, SEXP n_colsSEXP, SEXP first_rowSEXP, SEXP n_out_rowsSEXP, SEXP radiusSEXP, SEXP foregroundSEXP, SEXP backgroundSEXP, SEXP n_threadsSEXP) {
+BEGIN_RCPP
+    SEXP __sexp_result;
+    {
+        Rcpp::RNGScope __rngScope;
+        Rcpp::traits::input_parameter< arma::vec& >::type x(xSEXP );
+        Rcpp::traits::input_parameter< int >::type n_rows(n_rowsSEXP );
+        Rcpp::traits::input_parameter< int >::type n_cols(n_colsSEXP );
+        Rcpp::traits::input_parameter< int >::type first_row(first_rowSEXP );
+        Rcpp::traits::input_parameter< int >::type n_out_rows(n_out_rowsSEXP );
+        Rcpp::traits::input_parameter< double >::type radius(radiusSEXP );
+        Rcpp::traits::input_parameter< double >::type foreground(foregroundSEXP );
+        Rcpp::traits::input_parameter< double >::type background(backgroundSEXP );
+        Rcpp::traits::input_parameter< int >::type n_threads(n_threadsSEXP );
+        Rcpp::NumericVector __result = buffer_mask_block(x, n_rows, n_cols, first_row, n_out_rows, radius, foreground, background, n_threads);
+        PROTECT(__sexp_result = Rcpp::wrap(__result));
+    }
+    UNPROTECT(1);
+    return __sexp_result;
+END_RCPP
+}
+// accum_norm_moments
+arma::mat accum_norm_moments(arma::mat moments, arma::mat& x, arma::mat& y, arma::vec& msk);
+RcppExport SEXP teamlucc_accum_norm_moments(SEXP momentsSEXP, SEXP xSEXP, SEXP ySEXP, SEXP mskSEXP) {
+BEGIN_RCPP
+    SEXP __sexp_result;
+    {
+        Rcpp::RNGScope __rngScope;
+        Rcpp::traits::input_parameter< arma::mat >::type moments(momentsSEXP );
+        Rcpp::traits::input_parameter< arma::mat& >::type x(xSEXP );
+        Rcpp::traits::input_parameter< arma::mat& >::type y(ySEXP );
+        Rcpp::traits::input_parameter< arma::vec& >::type msk(mskSEXP );
+        arma::mat __result = accum_norm_moments(moments, x, y, msk);
+        PROTECT(__sexp_result = Rcpp::wrap(__result));
+    }
+    UNPROTECT(1);
+    return __sexp_result;
+END_RCPP
+}
+// calc_norm_models
+Rcpp::DataFrame calc_norm_models(arma::mat& moments);
+RcppExport SEXP teamlucc_calc_norm_models(SEXP momentsSEXP) {
+BEGIN_RCPP
+    SEXP __sexp_result;
+    {
+        Rcpp::RNGScope __rngScope;
+        Rcpp::traits::input_parameter< arma::mat& >::type moments(momentsSEXP );
+        Rcpp::DataFrame __result = calc_norm_models(moments);
+        PROTECT(__sexp_result = Rcpp::wrap(__result));
+    }
+    UNPROTECT(1);
+    return __sexp_result;
+END_RCPP
+}
+// apply_norm_models
+arma::mat apply_norm_models(arma::mat& y, arma::vec& slope, arma::vec& intercept, arma::vec& msk, std::string datatype = "");
+RcppExport SEXP teamlucc_apply_norm_models(SEXP ySEXP, SEXP slopeSEXP, SEXP interceptSEXP, SEXP mskSEXP, SEXP datatypeSEXP) {
+BEGIN_RCPP
+    SEXP __sexp_result;
+    {
+        Rcpp::RNGScope __rngScope;
+        Rcpp::traits::input_parameter< arma::mat& >::type y(ySEXP );
+        Rcpp::traits::input_parameter< arma::vec& >::type slope(slopeSEXP );
+        Rcpp::traits::input_parameter< arma::vec& >::type intercept(interceptSEXP );
+        Rcpp::traits::input_parameter< arma::vec& >::type msk(mskSEXP );
+        Rcpp::traits::input_parameter< std::string >::type datatype(datatypeSEXP );
+        arma::mat __result = apply_norm_models(y, slope, intercept, msk, datatype);
+        PROTECT(__sexp_result = Rcpp::wrap(__result));
+    }
+    UNPROTECT(1);
+    return __sexp_result;
+END_RCPP
+}
+// pack_mask
+Rcpp::IntegerVector pack_mask(Rcpp::NumericVector vals, int n_cols, int bits);
+RcppExport SEXP teamlucc_pack_mask(SEXP valsSEXP, SEXP n_colsSEXP, SEXP bitsSEXP) {
+BEGIN_RCPP
+    SEXP __sexp_result;
+    {
+        Rcpp::RNGScope __rngScope;
+        Rcpp::traits::input_parameter< Rcpp::NumericVector >::type vals(valsSEXP );
+        Rcpp::traits::input_parameter< int >::type n_cols(n_colsSEXP );
+        Rcpp::traits::input_parameter< int >::type bits(bitsSEXP );
+        Rcpp::IntegerVector __result = pack_mask(vals, n_cols, bits);
+        PROTECT(__sexp_result = Rcpp::wrap(__result));
+    }
+    UNPROTECT(1);
+    return __sexp_result;
+END_RCPP
+}
+// unpack_mask
+Rcpp::NumericVector unpack_mask(Rcpp::IntegerVector words, int n_cols, int bits);
+RcppExport SEXP teamlucc_unpack_mask(SEXP wordsSEXP, SEXP n_colsSEXP, SEXP bitsSEXP) {
+BEGIN_RCPP
+    SEXP __sexp_result;
+    {
+        Rcpp::RNGScope __rngScope;
+        Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type words(wordsSEXP );
+        Rcpp::traits::input_parameter< int >::type n_cols(n_colsSEXP );
+        Rcpp::traits::input_parameter< int >::type bits(bitsSEXP );
+        Rcpp::NumericVector __result = unpack_mask(words, n_cols, bits);
+        PROTECT(__sexp_result = Rcpp::wrap(__result));
+    }
+    UNPROTECT(1);
+    return __sexp_result;
+END_RCPP
+}
+// packed_mask_equal
+Rcpp::IntegerVector packed_mask_equal(Rcpp::IntegerVector words, int n_cols, int bits, int code);
+RcppExport SEXP teamlucc_packed_mask_equal(SEXP wordsSEXP, SEXP n_colsSEXP, SEXP bitsSEXP, SEXP codeSEXP) {
+BEGIN_RCPP
+    SEXP __sexp_result;
+    {
+        Rcpp::RNGScope __rngScope;
+        Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type words(wordsSEXP );
+        Rcpp::traits::input_parameter< int >::type n_cols(n_colsSEXP );
+        Rcpp::traits::input_parameter< int >::type bits(bitsSEXP );
+        Rcpp::traits::input_parameter< int >::type code(codeSEXP );
+        Rcpp::IntegerVector __result = packed_mask_equal(words, n_cols, bits, code);
+        PROTECT(__sexp_result = Rcpp::wrap(__result));
+    }
+    UNPROTECT(1);
+    return __sexp_result;
+END_RCPP
+}
+// packed_mask_op
+Rcpp::IntegerVector packed_mask_op(Rcpp::IntegerVector a, Rcpp::IntegerVector b, std::string op);
+RcppExport SEXP teamlucc_packed_mask_op(SEXP aSEXP, SEXP bSEXP, SEXP opSEXP) {
+BEGIN_RCPP
+    SEXP __sexp_result;
+    {
+        Rcpp::RNGScope __rngScope;
+        Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type a(aSEXP );
+        Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type b(bSEXP );
+        Rcpp::traits::input_parameter< std::string >::type op(opSEXP );
+        Rcpp::IntegerVector __result = packed_mask_op(a, b, op);
+        PROTECT(__sexp_result = Rcpp::wrap(__result));
+    }
+    UNPROTECT(1);
+    return __sexp_result;
+END_RCPP
+}
+// packed_mask_not
+Rcpp::IntegerVector packed_mask_not(Rcpp::IntegerVector words, int n_cols);
+RcppExport SEXP teamlucc_packed_mask_not(SEXP wordsSEXP, SEXP n_colsSEXP) {
+BEGIN_RCPP
+    SEXP __sexp_result;
+    {
+        Rcpp::RNGScope __rngScope;
+        Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type words(wordsSEXP );
+        Rcpp::traits::input_parameter< int >::type n_cols(n_colsSEXP );
+        Rcpp::IntegerVector __result = packed_mask_not(words, n_cols);
+        PROTECT(__sexp_result = Rcpp::wrap(__result));
+    }
+    UNPROTECT(1);
+    return __sexp_result;
+END_RCPP
+}
+// packed_mask_count
+double packed_mask_count(Rcpp::IntegerVector words);
+RcppExport SEXP teamlucc_packed_mask_count(SEXP wordsSEXP) {
+BEGIN_RCPP
+    SEXP __sexp_result;
+    {
+        Rcpp::RNGScope __rngScope;
+        Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type words(wordsSEXP );
+        double __result = packed_mask_count(words);
+        PROTECT(__sexp_result = Rcpp::wrap(__result));
+    }
+    UNPROTECT(1);
+    return __sexp_result;
+END_RCPP
+}
+// packed_mask_set
+Rcpp::IntegerVector packed_mask_set(Rcpp::IntegerVector words, int n_cols, Rcpp::IntegerVector where, int code);
+RcppExport SEXP teamlucc_packed_mask_set(SEXP wordsSEXP, SEXP n_colsSEXP, SEXP whereSEXP, SEXP codeSEXP) {
+BEGIN_RCPP
+    SEXP __sexp_result;
+    {
+        Rcpp::RNGScope __rngScope;
+        Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type words(wordsSEXP );
+        Rcpp::traits::input_parameter< int >::type n_cols(n_colsSEXP );
+        Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type where(whereSEXP );
+        Rcpp::traits::input_parameter< int >::type code(codeSEXP );
+        Rcpp::IntegerVector __result = packed_mask_set(words, n_cols, where, code);
+        PROTECT(__sexp_result = Rcpp::wrap(__result));
+    }
+    UNPROTECT(1);
+    return __sexp_result;
+END_RCPP
+}
+// write_packed_mask
+void write_packed_mask(std::string filename, Rcpp::IntegerVector words, int n_cols, int bits);
+RcppExport SEXP teamlucc_write_packed_mask(SEXP filenameSEXP, SEXP wordsSEXP, SEXP n_colsSEXP, SEXP bitsSEXP) {
+BEGIN_RCPP
+    {
+        Rcpp::RNGScope __rngScope;
+        Rcpp::traits::input_parameter< std::string >::type filename(filenameSEXP );
+        Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type words(wordsSEXP );
+        Rcpp::traits::input_parameter< int >::type n_cols(n_colsSEXP );
+        Rcpp::traits::input_parameter< int >::type bits(bitsSEXP );
+        write_packed_mask(filename, words, n_cols, bits);
+    }
+    return R_NilValue;
+END_RCPP
+}
+// read_packed_mask
+Rcpp::List read_packed_mask(std::string filename);
+RcppExport SEXP teamlucc_read_packed_mask(SEXP filenameSEXP) {
+BEGIN_RCPP
+    SEXP __sexp_result;
+    {
+        Rcpp::RNGScope __rngScope;
+        Rcpp::traits::input_parameter< std::string >::type filename(filenameSEXP );
+        Rcpp::List __result = read_packed_mask(filename);
+        PROTECT(__sexp_result = Rcpp::wrap(__result));
+    }
+    UNPROTECT(1);
+    return __sexp_result;
+END_RCPP
+}
+// write_pixel_store
+void write_pixel_store(std::string filename, Rcpp::List cols, Rcpp::IntegerVector y, Rcpp::IntegerVector poly);
+RcppExport SEXP teamlucc_write_pixel_store(SEXP filenameSEXP, SEXP colsSEXP, SEXP ySEXP, SEXP polySEXP) {
+BEGIN_RCPP
+    {
+        Rcpp::RNGScope __rngScope;
+        Rcpp::traits::input_parameter< std::string >::type filename(filenameSEXP );
+        Rcpp::traits::input_parameter< Rcpp::List >::type cols(colsSEXP );
+        Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type y(ySEXP );
+        Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type poly(polySEXP );
+        write_pixel_store(filename, cols, y, poly);
+    }
+    return R_NilValue;
+END_RCPP
+}
+// read_pixel_store
+Rcpp::List read_pixel_store(std::string filename, Rcpp::NumericVector rows);
+RcppExport SEXP teamlucc_read_pixel_store(SEXP filenameSEXP, SEXP rowsSEXP) {
+BEGIN_RCPP
+    SEXP __sexp_result;
+    {
+        Rcpp::RNGScope __rngScope;
+        Rcpp::traits::input_parameter< std::string >::type filename(filenameSEXP );
+        Rcpp::traits::input_parameter< Rcpp::NumericVector >::type rows(rowsSEXP );
+        Rcpp::List __result = read_pixel_store(filename, rows);
+        PROTECT(__sexp_result = Rcpp::wrap(__result));
+    }
+    UNPROTECT(1);
+    return __sexp_result;
+END_RCPP
+}
+// read_pixel_store_index
+Rcpp::List read_pixel_store_index(std::string filename);
+RcppExport SEXP teamlucc_read_pixel_store_index(SEXP filenameSEXP) {
+BEGIN_RCPP
+    SEXP __sexp_result;
+    {
+        Rcpp::RNGScope __rngScope;
+        Rcpp::traits::input_parameter< std::string >::type filename(filenameSEXP );
+        Rcpp::List __result = read_pixel_store_index(filename);
+        PROTECT(__sexp_result = Rcpp::wrap(__result));
+    }
+    UNPROTECT(1);
+    return __sexp_result;
+END_RCPP
+}
+// decode_qa_masks
+arma::mat decode_qa_masks(arma::mat& qa, std::string mask_type = "fmask");
+RcppExport SEXP teamlucc_decode_qa_masks(SEXP qaSEXP, SEXP mask_typeSEXP) {
+BEGIN_RCPP
+    SEXP __sexp_result;
+    {
+        Rcpp::RNGScope __rngScope;
+        Rcpp::traits::input_parameter< arma::mat& >::type qa(qaSEXP );
+        Rcpp::traits::input_parameter< std::string >::type mask_type(mask_typeSEXP );
+        arma::mat __result = decode_qa_masks(qa, mask_type);
+        PROTECT(__sexp_result = Rcpp::wrap(__result));
+    }
+    UNPROTECT(1);
+    return __sexp_result;
+END_RCPP
+}
+// accum_qa_hist
+arma::mat accum_qa_hist(arma::mat hist, arma::mat& qa, int n_threads = 0);
+RcppExport SEXP teamlucc_accum_qa_hist(SEXP histSEXP, SEXP qaSEXP, SEXP n_threadsSEXP) {
+BEGIN_RCPP
+    SEXP __sexp_result;
+    {
+        Rcpp::RNGScope __rngScope;
+        Rcpp::traits::input_parameter< arma::mat >::type hist(histSEXP );
+        Rcpp::traits::input_parameter< arma::mat& >::type qa(qaSEXP );
+        Rcpp::traits::input_parameter< int >::type n_threads(n_threadsSEXP );
+        arma::mat __result = accum_qa_hist(hist, qa, n_threads);
+        PROTECT(__sexp_result = Rcpp::wrap(__result));
+    }
+    UNPROTECT(1);
+    return __sexp_result;
+END_RCPP
+}
+// quantize_probs
+arma::mat quantize_probs(arma::mat probs, double scale);
+RcppExport SEXP teamlucc_quantize_probs(SEXP probsSEXP, SEXP scaleSEXP) {
+BEGIN_RCPP
+    SEXP __sexp_result;
+    {
+        Rcpp::RNGScope __rngScope;
+        Rcpp::traits::input_parameter< arma::mat >::type probs(probsSEXP );
+        Rcpp::traits::input_parameter< double >::type scale(scaleSEXP );
+        arma::mat __result = quantize_probs(probs, scale);
+        PROTECT(__sexp_result = Rcpp::wrap(__result));
+    }
+    UNPROTECT(1);
+    return __sexp_result;
+END_RCPP
+}
+// accum_strata_sample
+Rcpp::List accum_strata_sample(Rcpp::List samp, arma::vec& strata, double first_cell, int size, bool na_rm = true);
+RcppExport SEXP teamlucc_accum_strata_sample(SEXP sampSEXP, SEXP strataSEXP, SEXP first_cellSEXP, SEXP sizeSEXP, SEXP na_rmSEXP) {
+BEGIN_RCPP
+    SEXP __sexp_result;
+    {
+        Rcpp::RNGScope __rngScope;
+        Rcpp::traits::input_parameter< Rcpp::List >::type samp(sampSEXP );
+        Rcpp::traits::input_parameter< arma::vec& >::type strata(strataSEXP );
+        Rcpp::traits::input_parameter< double >::type first_cell(first_cellSEXP );
+        Rcpp::traits::input_parameter< int >::type size(sizeSEXP );
+        Rcpp::traits::input_parameter< bool >::type na_rm(na_rmSEXP );
+        Rcpp::List __result = accum_strata_sample(samp, strata, first_cell, size, na_rm);
+        PROTECT(__sexp_result = Rcpp::wrap(__result));
+    }
+    UNPROTECT(1);
+    return __sexp_result;
+END_RCPP
+}
+// rf_predict_prob
+arma::mat rf_predict_prob(arma::mat& x, Rcpp::List forest, int n_threads = 0);
+RcppExport SEXP teamlucc_rf_predict_prob(SEXP xSEXP, SEXP forestSEXP, SEXP n_threadsSEXP) {
+BEGIN_RCPP
+    SEXP __sexp_result;
+    {
+        Rcpp::RNGScope __rngScope;
+        Rcpp::traits::input_parameter< arma::mat& >::type x(xSEXP );
+        Rcpp::traits::input_parameter< Rcpp::List >::type forest(forestSEXP );
+        Rcpp::traits::input_parameter< int >::type n_threads(n_threadsSEXP );
+        arma::mat __result = rf_predict_prob(x, forest, n_threads);
+        PROTECT(__sexp_result = Rcpp::wrap(__result));
+    }
+    UNPROTECT(1);
+    return __sexp_result;
+END_RCPP
+}
+// scanline_cells
+Rcpp::List scanline_cells(arma::vec& vx, arma::vec& vy, arma::uvec& ring_start, arma::uvec& ring_poly, int n_poly, double xmin, double ymax, double res_x, double res_y, int nrows, int ncols, bool small = true, int n_threads = 0);
+RcppExport SEXP teamlucc_scanline_cells(SEXP vxSEXP, SEXP vySEXP, SEXP ring_startSEXP, SEXP ring_polySEXP, SEXP n_polySEXP, SEXP xminSEXP, SEXP ymaxSEXP, SEXP res_xSEXP, SEXP res_ySEXP, SEXP nrowsSEXP, SEXP ncolsSEXP, SEXP smallSEXP, SEXP n_threadsSEXP) {
+BEGIN_RCPP
+    SEXP __sexp_result;
+    {
+        Rcpp::RNGScope __rngScope;
+        Rcpp::traits::input_parameter< arma::vec& >::type vx(vxSEXP );
+        Rcpp::traits::input_parameter< arma::vec& >::type vy(vySEXP );
+        Rcpp::traits::input_parameter< arma::uvec& >::type ring_start(ring_startSEXP );
+        Rcpp::traits::input_parameter< arma::uvec& >::type ring_poly(ring_polySEXP );
+        Rcpp::traits::input_parameter< int >::type n_poly(n_polySEXP );
+        Rcpp::traits::input_parameter< double >::type xmin(xminSEXP );
+        Rcpp::traits::input_parameter< double >::type ymax(ymaxSEXP );
+        Rcpp::traits::input_parameter< double >::type res_x(res_xSEXP );
+        Rcpp::traits::input_parameter< double >::type res_y(res_ySEXP );
+        Rcpp::traits::input_parameter< int >::type nrows(nrowsSEXP );
+        Rcpp::traits::input_parameter< int >::type ncols(ncolsSEXP );
+        Rcpp::traits::input_parameter< bool >::type small(smallSEXP );
+        Rcpp::traits::input_parameter< int >::type n_threads(n_threadsSEXP );
+        Rcpp::List __result = scanline_cells(vx, vy, ring_start, ring_poly, n_poly, xmin, ymax, res_x, res_y, nrows, ncols, small, n_threads);
+        PROTECT(__sexp_result = Rcpp::wrap(__result));
+    }
+    UNPROTECT(1);
+    return __sexp_result;
+END_RCPP
+}
+// sieve_init
+SEXP sieve_init(int n_cols, int directions = 8);
+RcppExport SEXP teamlucc_sieve_init(SEXP n_colsSEXP, SEXP directionsSEXP) {
+BEGIN_RCPP
+    SEXP __sexp_result;
+    {
+        Rcpp::RNGScope __rngScope;
+        Rcpp::traits::input_parameter< int >::type n_cols(n_colsSEXP );
+        Rcpp::traits::input_parameter< int >::type directions(directionsSEXP );
+        SEXP __result = sieve_init(n_cols, directions);
+        PROTECT(__sexp_result = Rcpp::wrap(__result));
+    }
+    UNPROTECT(1);
+    return __sexp_result;
+END_RCPP
+}
+// sieve_label_block
+void sieve_label_block(SEXP state, Rcpp::NumericVector x);
+RcppExport SEXP teamlucc_sieve_label_block(SEXP stateSEXP, SEXP xSEXP) {
+BEGIN_RCPP
+    {
+        Rcpp::RNGScope __rngScope;
+        Rcpp::traits::input_parameter< SEXP >::type state(stateSEXP );
+        Rcpp::traits::input_parameter< Rcpp::NumericVector >::type x(xSEXP );
+        sieve_label_block(state, x);
+    }
+    return R_NilValue;
+END_RCPP
+}
+// sieve_resolve
+Rcpp::List sieve_resolve(SEXP state, double min_pixels);
+RcppExport SEXP teamlucc_sieve_resolve(SEXP stateSEXP, SEXP min_pixelsSEXP) {
+BEGIN_RCPP
+    SEXP __sexp_result;
+    {
+        Rcpp::RNGScope __rngScope;
+        Rcpp::traits::input_parameter< SEXP >::type state(stateSEXP );
+        Rcpp::traits::input_parameter< double >::type min_pixels(min_pixelsSEXP );
+        Rcpp::List __result = sieve_resolve(state, min_pixels);
+        PROTECT(__sexp_result = Rcpp::wrap(__result));
+    }
+    UNPROTECT(1);
+    return __sexp_result;
+END_RCPP
+}
+// sieve_apply_block
+Rcpp::NumericVector sieve_apply_block(SEXP state, Rcpp::NumericVector x);
+RcppExport SEXP teamlucc_sieve_apply_block(SEXP stateSEXP, SEXP xSEXP) {
+BEGIN_RCPP
+    SEXP __sexp_result;
+    {
+        Rcpp::RNGScope __rngScope;
+        Rcpp::traits::input_parameter< SEXP >::type state(stateSEXP );
+        Rcpp::traits::input_parameter< Rcpp::NumericVector >::type x(xSEXP );
+        Rcpp::NumericVector __result = sieve_apply_block(state, x);
+        PROTECT(__sexp_result = Rcpp::wrap(__result));
+    }
+    UNPROTECT(1);
+    return __sexp_result;
+END_RCPP
+}
+// svm_predict_prob
+arma::mat svm_predict_prob(arma::mat& x, Rcpp::List svm, int n_threads = 0);
+RcppExport SEXP teamlucc_svm_predict_prob(SEXP xSEXP, SEXP svmSEXP, SEXP n_threadsSEXP) {
+BEGIN_RCPP
+    SEXP __sexp_result;
+    {
+        Rcpp::RNGScope __rngScope;
+        Rcpp::traits::input_parameter< arma::mat& >::type x(xSEXP );
+        Rcpp::traits::input_parameter< Rcpp::List >::type svm(svmSEXP );
+        Rcpp::traits::input_parameter< int >::type n_threads(n_threadsSEXP );
+        arma::mat __result = svm_predict_prob(x, svm, n_threads);
+        PROTECT(__sexp_result = Rcpp::wrap(__result));
+    }
+    UNPROTECT(1);
+    return __sexp_result;
+END_RCPP
+}
+// read_tts
+arma::mat read_tts(std::string filename, int n_threads = 0);
+RcppExport SEXP teamlucc_read_tts(SEXP filenameSEXP, SEXP n_threadsSEXP) {
+BEGIN_RCPP
+    SEXP __sexp_result;
+    {
+        Rcpp::RNGScope __rngScope;
+        Rcpp::traits::input_parameter< std::string >::type filename(filenameSEXP );
+        Rcpp::traits::input_parameter< int >::type n_threads(n_threadsSEXP );
+        arma::mat __result = read_tts(filename, n_threads);
+        PROTECT(__sexp_result = Rcpp::wrap(__result));
+    }
+    UNPROTECT(1);
+    return __sexp_result;
+END_RCPP
+}
+// read_tpa
+arma::mat read_tpa(std::string filename, int max_num_seasons = 0, int n_threads = 0);
+RcppExport SEXP teamlucc_read_tpa(SEXP filenameSEXP, SEXP max_num_seasonsSEXP, SEXP n_threadsSEXP) {
+BEGIN_RCPP
+    SEXP __sexp_result;
+    {
+        Rcpp::RNGScope __rngScope;
+        Rcpp::traits::input_parameter< std::string >::type filename(filenameSEXP );
+        Rcpp::traits::input_parameter< int >::type max_num_seasons(max_num_seasonsSEXP );
+        Rcpp::traits::input_parameter< int >::type n_threads(n_threadsSEXP );
+        arma::mat __result = read_tpa(filename, max_num_seasons, n_threads);
+        PROTECT(__sexp_result = Rcpp::wrap(__result));
+    }
+    UNPROTECT(1);
+    return __sexp_result;
+END_RCPP
+}
+// index_timesat_rows
+Rcpp::List index_timesat_rows(std::string filename, int n_rows);
+RcppExport SEXP teamlucc_index_timesat_rows(SEXP filenameSEXP, SEXP n_rowsSEXP) {
+BEGIN_RCPP
+    SEXP __sexp_result;
+    {
+        Rcpp::RNGScope __rngScope;
+        Rcpp::traits::input_parameter< std::string >::type filename(filenameSEXP );
+        Rcpp::traits::input_parameter< int >::type n_rows(n_rowsSEXP );
+        Rcpp::List __result = index_timesat_rows(filename, n_rows);
+        PROTECT(__sexp_result = Rcpp::wrap(__result));
+    }
+    UNPROTECT(1);
+    return __sexp_result;
+END_RCPP
+}
+// decode_timesat_block
+arma::mat decode_timesat_block(std::string filename, double start_offset, double end_offset, int first_row, int n_rows, int n_cols, int n_bands, int indicator = 1);
+RcppExport SEXP teamlucc_decode_timesat_block(SEXP filenameSEXP, SEXP start_offsetSEXP, SEXP end_offsetSEXP, SEXP first_rowSEXP, SEXP n_rowsSEXP, SEXP n_colsSEXP, SEXP n_bandsSEXP, SEXP indicatorSEXP) {
+BEGIN_RCPP
+    SEXP __sexp_result;
+    {
+        Rcpp::RNGScope __rngScope;
+        Rcpp::traits::input_parameter< std::string >::type filename(filenameSEXP );
+        Rcpp::traits::input_parameter< double >::type start_offset(start_offsetSEXP );
+        Rcpp::traits::input_parameter< double >::type end_offset(end_offsetSEXP );
+        Rcpp::traits::input_parameter< int >::type first_row(first_rowSEXP );
+        Rcpp::traits::input_parameter< int >::type n_rows(n_rowsSEXP );
+        Rcpp::traits::input_parameter< int >::type n_cols(n_colsSEXP );
+        Rcpp::traits::input_parameter< int >::type n_bands(n_bandsSEXP );
+        Rcpp::traits::input_parameter< int >::type indicator(indicatorSEXP );
+        arma::mat __result = decode_timesat_block(filename, start_offset, end_offset, first_row, n_rows, n_cols, n_bands, indicator);
+        PROTECT(__sexp_result = Rcpp::wrap(__result));
+    }
+    UNPROTECT(1);
+    return __sexp_result;
+END_RCPP
+}
+// window_kernel_info
+Rcpp::List window_kernel_info(std::string kernel, Rcpp::List params);
+RcppExport SEXP teamlucc_window_kernel_info(SEXP kernelSEXP, SEXP paramsSEXP) {
+BEGIN_RCPP
+    SEXP __sexp_result;
+    {
+        Rcpp::RNGScope __rngScope;
+        Rcpp::traits::input_parameter< std::string >::type kernel(kernelSEXP );
+        Rcpp::traits::input_parameter< Rcpp::List >::type params(paramsSEXP );
+        Rcpp::List __result = window_kernel_info(kernel, params);
+        PROTECT(__sexp_result = Rcpp::wrap(__result));
+    }
+    UNPROTECT(1);
+    return __sexp_result;
+END_RCPP
+}
+// run_window_kernel
+arma::mat run_window_kernel(arma::mat& block, int n_rows, int n_cols, int first_row, int n_out_rows, std::string kernel, Rcpp::List params, int n_threads = 0);
+RcppExport SEXP teamlucc_run_window_kernel(SEXP blockSEXP, SEXP n_rowsSEXP, SEXP n_colsSEXP, SEXP first_rowSEXP, SEXP n_out_rowsSEXP, SEXP kernelSEXP, SEXP paramsSEXP, SEXP n_threadsSEXP) {
+BEGIN_RCPP
+    SEXP __sexp_result;
+    {
+        Rcpp::RNGScope __rngScope;
+        Rcpp::traits::input_parameter< arma::mat& >::type block(blockSEXP );
+        Rcpp::traits::input_parameter< int >::type n_rows(n_rowsSEXP );
+        Rcpp::traits::input_parameter< int >::type n_cols(n_colsSEXP );
+        Rcpp::traits::input_parameter< int >::type first_row(first_rowSEXP );
+        Rcpp::traits::input_parameter< int >::type n_out_rows(n_out_rowsSEXP );
+        Rcpp::traits::input_parameter< std::string >::type kernel(kernelSEXP );
+        Rcpp::traits::input_parameter< Rcpp::List >::type params(paramsSEXP );
+        Rcpp::traits::input_parameter< int >::type n_threads(n_threadsSEXP );
+        arma::mat __result = run_window_kernel(block, n_rows, n_cols, first_row, n_out_rows, kernel, params, n_threads);
+        PROTECT(__sexp_result = Rcpp::wrap(__result));
+    }
+    UNPROTECT(1);
+    return __sexp_result;
+END_RCPP
+}
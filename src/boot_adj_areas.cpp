@@ -0,0 +1,117 @@
+#include <RcppArmadillo.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace arma;
+
+// Small, fast random number generator (splitmix64) used so that each
+// bootstrap replicate has its own independent stream. Streams are keyed by
+// the replicate number, so results do not depend on the number of threads.
+struct boot_rng {
+    unsigned long long state;
+    boot_rng(unsigned long long seed, unsigned long long stream) {
+        state = seed ^ (stream * 0x9E3779B97F4A7C15ULL);
+        next();
+    }
+    unsigned long long next() {
+        unsigned long long z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return(z ^ (z >> 31));
+    }
+    // Uniform on [0, 1)
+    double unif() {
+        return((next() >> 11) * (1.0 / 9007199254740992.0));
+    }
+};
+
+//' Bootstrap error-adjusted areas and disagreement statistics
+//'
+//' Resamples the testing pixels within each mapped class (stratum) with
+//' replacement, and for each replicate recalculates the population
+//' contingency table, the error-adjusted area of each class, and quantity
+//' (\code{Q}) and allocation (\code{A}) disagreement. Replicates are run in
+//' parallel when OpenMP is available, each with its own random number stream,
+//' so results are reproducible for a given \code{seed} regardless of the
+//' number of threads. This function is called by the
+//' \code{\link{adj_areas_ci}} function. It is not intended to be used
+//' directly.
+//'
+//' @param ct sample contingency table, with predicted (mapped) classes in
+//' rows and observed classes in columns
+//' @param pop the population (mapped area) of each class
+//' @param n_boot number of bootstrap replicates
+//' @param seed seed for the random number streams
+//' @param n_threads number of threads to use (if 0, use the OpenMP default)
+//' @return matrix with one row per replicate, and columns giving the adjusted
+//' area of each class, followed by \code{Q} and \code{A}
+// [[Rcpp::export]]
+arma::mat boot_adj_areas(arma::mat& ct, arma::vec& pop, int n_boot,
+        double seed, int n_threads=0) {
+    unsigned n_class = ct.n_rows;
+    if (ct.n_cols != n_class) {
+        Rcpp::stop("ct must be a square matrix");
+    }
+    if (pop.n_elem != n_class) {
+        Rcpp::stop("pop must have one element per row of ct");
+    }
+    if (n_boot < 1) {
+        Rcpp::stop("n_boot must be at least 1");
+    }
+    double total_pop = accu(pop);
+    vec W = pop / total_pop;
+
+    // Cumulative distribution of observed classes within each stratum, used
+    // to draw the resampled pixels
+    vec n_strata = sum(ct, 1);
+    mat cum_p = cumsum(ct, 1);
+    for (unsigned i = 0; i < n_class; i++) {
+        if (n_strata(i) > 0) cum_p.row(i) /= n_strata(i);
+    }
+
+    mat out(n_boot, n_class + 2);
+    unsigned long long seed_int = (unsigned long long) seed;
+
+    int n_thr = 1;
+#ifdef _OPENMP
+    n_thr = n_threads > 0 ? n_threads : omp_get_max_threads();
+#endif
+    #pragma omp parallel num_threads(n_thr)
+    {
+        mat pop_ct(n_class, n_class);
+        #pragma omp for schedule(static)
+        for (int rep = 0; rep < n_boot; rep++) {
+            boot_rng rng(seed_int, rep);
+            pop_ct.zeros();
+            for (unsigned i = 0; i < n_class; i++) {
+                unsigned n_i = (unsigned) n_strata(i);
+                if (n_i == 0) {
+                    pop_ct.row(i).fill(datum::nan);
+                    continue;
+                }
+                for (unsigned s = 0; s < n_i; s++) {
+                    double u = rng.unif();
+                    unsigned j = 0;
+                    while (j < n_class - 1 && u >= cum_p(i, j)) j++;
+                    pop_ct(i, j)++;
+                }
+                pop_ct.row(i) *= W(i) / n_i;
+            }
+            // Adjusted areas, and quantity and allocation disagreement
+            // (Pontius and Millones, 2011, eqns 2-5)
+            double Q = 0, A = 0;
+            for (unsigned g = 0; g < n_class; g++) {
+                double row_sum = accu(pop_ct.row(g));
+                double col_sum = accu(pop_ct.col(g));
+                out(rep, g) = total_pop * col_sum;
+                Q += fabs(row_sum - col_sum);
+                A += std::min(row_sum - pop_ct(g, g), col_sum - pop_ct(g, g));
+            }
+            out(rep, n_class) = Q / 2;
+            out(rep, n_class + 1) = A;
+        }
+    }
+
+    return(out);
+}
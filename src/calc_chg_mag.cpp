@@ -0,0 +1,33 @@
+#include <RcppArmadillo.h>
+
+using namespace arma;
+
+//' Calculate change magnitude
+//'
+//' This code calculate the change magnitude from two probability images. Not
+//' intended to be called directly - see \code{chg_mag}.
+//'
+//' @param t1p time 1 posterior probability matrix (with pixels in rows, bands 
+//' in columns)
+//' @param t2p time 2 posterior probability matrix (with pixels in rows, bands 
+//' in columns)
+//' @param scale the factor the probabilities were scaled by when they were 
+//' stored (1 for unscaled probabilities)
+//' @return vector of change magnitudes
+//' @references Chen, J., X. Chen, X. Cui, and J. Chen. 2011. Change vector 
+//' analysis in posterior probability space: a new method for land cover change 
+//' detection.  IEEE Geoscience and Remote Sensing Letters 8:317-321.
+// [[Rcpp::export]]
+arma::vec calc_chg_mag(arma::mat& t1p, arma::mat& t2p, double scale=1) {
+    vec chg_mag(t1p.n_rows);
+    for (unsigned pix_num = 0; pix_num < t1p.n_rows; pix_num++) {
+        double sum_sq = 0;
+        for (unsigned i = 0; i < t1p.n_cols; i++) {
+            double dP = t2p(pix_num, i) - t1p(pix_num, i);
+            sum_sq += dP * dP;
+        }
+        // Note that NAs propagate through sum_sq
+        chg_mag(pix_num) = sqrt(sum_sq) / scale;
+    }
+    return(chg_mag);
+}
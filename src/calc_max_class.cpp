@@ -0,0 +1,45 @@
+#include <RcppArmadillo.h>
+
+using namespace arma;
+
+//' Calculate the highest probability class from class probabilities
+//'
+//' Finds the class with the highest probability for each pixel. Classes are
+//' coded starting at zero (as software like ENVI starts class codes at zero).
+//' Pixels where two or more classes tie for the highest probability, or with
+//' missing probabilities, are coded as NA. This function is called by the
+//' \code{\link{classify}} function. It is not intended to be used directly.
+//'
+//' @param probs class probability matrix (with pixels in rows, classes in
+//' columns)
+//' @return vector of predicted class codes
+// [[Rcpp::export]]
+Rcpp::NumericVector calc_max_class(arma::mat& probs) {
+    Rcpp::NumericVector classes(probs.n_rows);
+    for (unsigned pix_num = 0; pix_num < probs.n_rows; pix_num++) {
+        double max_prob = -datum::inf;
+        int max_class = -1;
+        bool has_na = false;
+        bool tie = false;
+        for (unsigned i = 0; i < probs.n_cols; i++) {
+            double prob = probs(pix_num, i);
+            if (!is_finite(prob)) {
+                has_na = true;
+                break;
+            }
+            if (prob > max_prob) {
+                max_prob = prob;
+                max_class = i;
+                tie = false;
+            } else if (prob == max_prob) {
+                tie = true;
+            }
+        }
+        if (has_na || tie || max_class < 0) {
+            classes[pix_num] = NA_REAL;
+        } else {
+            classes[pix_num] = max_class;
+        }
+    }
+    return(classes);
+}
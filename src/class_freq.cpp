@@ -0,0 +1,93 @@
+#include <RcppArmadillo.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace arma;
+
+//' Accumulate class frequencies from a block of a classified image
+//'
+//' Counts the number of pixels in each class in a single pass over a block of
+//' class codes, using one integer histogram per thread that are summed at the
+//' end of the pass. Class codes must be non-negative integers. Missing values
+//' are skipped. This function is called by the \code{\link{accuracy}}
+//' function, once per block of pixels. It is not intended to be used directly.
+//'
+//' @param freqs the vector returned by a previous call to
+//' \code{accum_class_freq}, or an empty vector to start a new accumulation
+//' @param classes vector of class codes
+//' @param n_threads number of threads to use (if 0, use the OpenMP default)
+//' @return vector of frequencies, with the frequency of class code \code{i} in
+//' element \code{i + 1}
+// [[Rcpp::export]]
+arma::vec accum_class_freq(arma::vec freqs, arma::vec& classes,
+        int n_threads=0) {
+    double max_class = -1;
+    for (unsigned i = 0; i < classes.n_elem; i++) {
+        double val = classes(i);
+        if (!is_finite(val)) continue;
+        if (val < 0 || val != floor(val)) {
+            Rcpp::stop("class codes must be non-negative integers");
+        }
+        if (val > max_class) max_class = val;
+    }
+    unsigned n_bins = std::max<unsigned>(freqs.n_elem, max_class + 1);
+    if (freqs.n_elem < n_bins) freqs.resize(n_bins);
+
+    int n_thr = 1;
+#ifdef _OPENMP
+    n_thr = n_threads > 0 ? n_threads : omp_get_max_threads();
+#endif
+    std::vector<std::vector<unsigned long> > hists(n_thr,
+            std::vector<unsigned long>(n_bins, 0));
+    #pragma omp parallel num_threads(n_thr)
+    {
+        int thread_num = 0;
+#ifdef _OPENMP
+        thread_num = omp_get_thread_num();
+#endif
+        std::vector<unsigned long>& hist = hists[thread_num];
+        #pragma omp for schedule(static)
+        for (unsigned i = 0; i < classes.n_elem; i++) {
+            double val = classes(i);
+            if (is_finite(val)) hist[(unsigned) val]++;
+        }
+    }
+    for (int t = 0; t < n_thr; t++) {
+        for (unsigned b = 0; b < n_bins; b++) freqs(b) += hists[t][b];
+    }
+    return(freqs);
+}
+
+//' Build a contingency table from predicted and observed class codes
+//'
+//' Tabulates pairs of predicted and observed class codes (as 1-based level
+//' numbers, as given by \code{as.integer} on a factor) into a contingency
+//' table in a single pass. Pairs where either code is missing are skipped.
+//' This function is called by the \code{\link{accuracy}} function. It is not
+//' intended to be used directly.
+//'
+//' @param predicted vector of predicted class codes
+//' @param observed vector of observed class codes
+//' @param n_predicted number of predicted classes (rows in the output)
+//' @param n_observed number of observed classes (columns in the output)
+//' @return contingency table as a matrix with predicted classes in rows and
+//' observed classes in columns
+// [[Rcpp::export]]
+arma::mat calc_ct(arma::vec& predicted, arma::vec& observed, int n_predicted,
+        int n_observed) {
+    if (predicted.n_elem != observed.n_elem) {
+        Rcpp::stop("predicted and observed must be the same length");
+    }
+    mat ct(n_predicted, n_observed, fill::zeros);
+    for (unsigned i = 0; i < predicted.n_elem; i++) {
+        double p = predicted(i);
+        double o = observed(i);
+        if (!is_finite(p) || !is_finite(o)) continue;
+        if (p < 1 || p > n_predicted || o < 1 || o > n_observed) {
+            Rcpp::stop("class code out of range");
+        }
+        ct((unsigned) p - 1, (unsigned) o - 1)++;
+    }
+    return(ct);
+}
@@ -0,0 +1,130 @@
+#include <RcppArmadillo.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace arma;
+
+// Columns of the statistics matrix used by accum_class_stats (one row per
+// class and band, with row class * n_bands + band)
+enum {
+    CS_N = 0,
+    CS_MEAN,
+    CS_M2,
+    CS_MIN,
+    CS_MAX,
+    CS_NCOLS
+};
+
+// Merge the partial statistics in row j of b into row i of a (Chan et al.
+// 1979 pairwise update)
+static void merge_class_stats(mat& a, unsigned i, const mat& b, unsigned j) {
+    double n_b = b(j, CS_N);
+    if (n_b == 0) return;
+    double n_a = a(i, CS_N);
+    double n = n_a + n_b;
+    double delta = b(j, CS_MEAN) - a(i, CS_MEAN);
+    a(i, CS_MEAN) += delta * n_b / n;
+    a(i, CS_M2) += b(j, CS_M2) + delta * delta * n_a * n_b / n;
+    a(i, CS_N) = n;
+    if (b(j, CS_MIN) < a(i, CS_MIN)) a(i, CS_MIN) = b(j, CS_MIN);
+    if (b(j, CS_MAX) > a(i, CS_MAX)) a(i, CS_MAX) = b(j, CS_MAX);
+}
+
+static mat init_class_stats(unsigned n_rows) {
+    mat stats(n_rows, CS_NCOLS, fill::zeros);
+    stats.col(CS_MIN).fill(datum::inf);
+    stats.col(CS_MAX).fill(-datum::inf);
+    return(stats);
+}
+
+//' Accumulate per-class band statistics
+//'
+//' Updates the count, mean, sum of squared deviations from the mean, minimum,
+//' and maximum of each band for each class, in a single pass over a block of
+//' pixels. Each thread accumulates its own partial statistics using Welford
+//' updates, and the partial statistics are merged at the end of the pass.
+//' Class codes must be non-negative integers. Pixels with a missing class code
+//' are skipped, as are missing band values. This function is called by the
+//' \code{\link{class_statistics}} function, once per block of pixels. It is
+//' not intended to be used directly.
+//'
+//' @param stats the matrix returned by a previous call to
+//' \code{accum_class_stats}, or an empty matrix to start a new accumulation
+//' @param x the image as a matrix, with pixels in rows and bands in columns
+//' @param classes vector of class codes, one per pixel
+//' @param n_threads number of threads to use (if 0, use the OpenMP default)
+//' @return matrix of statistics, with columns giving the count, mean, sum of
+//' squared deviations, minimum and maximum, and one row per class and band
+//' (with the statistics for band \code{j} of class code \code{i} in row
+//' \code{i * ncol(x) + j + 1})
+// [[Rcpp::export]]
+arma::mat accum_class_stats(arma::mat stats, arma::mat& x, arma::vec& classes,
+        int n_threads=0) {
+    if (classes.n_elem != x.n_rows) {
+        Rcpp::stop("classes must have one element per pixel");
+    }
+    unsigned n_bands = x.n_cols;
+    if (stats.n_elem != 0 &&
+            (stats.n_cols != CS_NCOLS || stats.n_rows % n_bands != 0)) {
+        Rcpp::stop("stats does not match the number of bands in x");
+    }
+    double max_class = -1;
+    for (unsigned i = 0; i < classes.n_elem; i++) {
+        double val = classes(i);
+        if (!is_finite(val)) continue;
+        if (val < 0 || val != floor(val)) {
+            Rcpp::stop("class codes must be non-negative integers");
+        }
+        if (val > max_class) max_class = val;
+    }
+    unsigned n_rows = std::max<unsigned>(stats.n_rows,
+                                         (max_class + 1) * n_bands);
+    if (stats.n_rows < n_rows) {
+        mat new_stats = init_class_stats(n_rows);
+        if (stats.n_rows > 0) {
+            new_stats.rows(0, stats.n_rows - 1) = stats;
+        }
+        stats = new_stats;
+    }
+
+    int n_thr = 1;
+#ifdef _OPENMP
+    n_thr = n_threads > 0 ? n_threads : omp_get_max_threads();
+#endif
+    std::vector<mat> partials(n_thr);
+    #pragma omp parallel num_threads(n_thr)
+    {
+        int thread_num = 0;
+#ifdef _OPENMP
+        thread_num = omp_get_thread_num();
+#endif
+        mat part = init_class_stats(n_rows);
+        #pragma omp for schedule(static)
+        for (unsigned i = 0; i < x.n_rows; i++) {
+            double cls = classes(i);
+            if (!is_finite(cls)) continue;
+            unsigned first_row = (unsigned) cls * n_bands;
+            for (unsigned band = 0; band < n_bands; band++) {
+                double val = x(i, band);
+                if (!is_finite(val)) continue;
+                unsigned r = first_row + band;
+                double n = ++part(r, CS_N);
+                double delta = val - part(r, CS_MEAN);
+                part(r, CS_MEAN) += delta / n;
+                part(r, CS_M2) += delta * (val - part(r, CS_MEAN));
+                if (val < part(r, CS_MIN)) part(r, CS_MIN) = val;
+                if (val > part(r, CS_MAX)) part(r, CS_MAX) = val;
+            }
+        }
+        partials[thread_num] = part;
+    }
+    for (int t = 0; t < n_thr; t++) {
+        // Skip threads that were not started
+        if (partials[t].n_rows == 0) continue;
+        for (unsigned r = 0; r < n_rows; r++) {
+            merge_class_stats(stats, r, partials[t], r);
+        }
+    }
+    return(stats);
+}
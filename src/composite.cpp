@@ -0,0 +1,123 @@
+#include <RcppArmadillo.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace arma;
+
+// Mask codes used by the cloud fill functions
+const double MASK_CLEAR = 0;
+const double MASK_CLOUD = 1;
+const double MASK_FILL = 2;
+
+//' Choose the best available pixel from a set of images, for a block of pixels
+//'
+//' For each pixel, scores every image where the pixel is clear, and copies
+//' the pixel from the image with the highest score. The score of an image is
+//' \code{date_scores} for that image, plus \code{w_ndvi} times the NDVI of
+//' the pixel, minus \code{w_brightness} times the brightness of the pixel
+//' (the mean of its band values divided by \code{scale}). Ties go to the
+//' image that comes first. This function is called by
+//' \code{\link{composite_images}}, once per block of pixels. It is not
+//' intended to be used directly.
+//'
+//' @param vals the image values as a matrix, with pixels in rows, and the
+//' bands of each image in columns (all the bands of the first image, followed
+//' by all the bands of the second image, etc.)
+//' @param codes the mask codes as a matrix, with pixels in rows and images in
+//' columns (0 for clear, 1 for cloud or cloud shadow, 2 for fill, and
+//' \code{NA} for missing). Only clear pixels with no missing band values are
+//' used.
+//' @param date_scores the score of each image that does not depend on the
+//' pixel (for example, a penalty for distance from a base date)
+//' @param red_band the (1 based) band number of the red band (used for NDVI)
+//' @param nir_band the (1 based) band number of the near infrared band (used
+//' for NDVI)
+//' @param w_ndvi the weight of NDVI in the score (if 0, NDVI is not
+//' calculated)
+//' @param w_brightness the weight of brightness in the score
+//' @param scale the value of a band that corresponds to a reflectance of 1
+//' (used for brightness)
+//' @param n_threads number of threads to use (if 0, use the OpenMP default)
+//' @return matrix with one row per pixel, with the bands of the composite,
+//' followed by the (1 based) index of the selected image, and the mask code
+//' of the composite (0 if a clear pixel was found, 2 if the pixel is fill in
+//' all images, and 1 otherwise). Pixels with no clear image are \code{NA} in
+//' the composite bands and the image index.
+// [[Rcpp::export]]
+arma::mat composite_block(arma::mat& vals, arma::mat& codes,
+        arma::vec date_scores, int red_band=0, int nir_band=0,
+        double w_ndvi=0, double w_brightness=0, double scale=10000,
+        int n_threads=0) {
+    unsigned n_imgs = codes.n_cols;
+    if (n_imgs == 0) Rcpp::stop("no images to composite");
+    if (date_scores.n_elem != n_imgs) {
+        Rcpp::stop("date_scores must have one element per image");
+    }
+    if (vals.n_rows != codes.n_rows || vals.n_cols % n_imgs != 0) {
+        Rcpp::stop("vals and codes do not match");
+    }
+    unsigned n_bands = vals.n_cols / n_imgs;
+    bool use_ndvi = w_ndvi != 0;
+    if (use_ndvi && (red_band < 1 || (unsigned) red_band > n_bands ||
+                     nir_band < 1 || (unsigned) nir_band > n_bands)) {
+        Rcpp::stop("red_band and nir_band must be band numbers to use NDVI");
+    }
+    bool use_brightness = w_brightness != 0;
+
+    int n_thr = 1;
+#ifdef _OPENMP
+    n_thr = n_threads > 0 ? n_threads : omp_get_max_threads();
+#endif
+
+    mat out(vals.n_rows, n_bands + 2);
+    #pragma omp parallel for num_threads(n_thr) schedule(static)
+    for (int i = 0; i < (int) vals.n_rows; i++) {
+        int best = -1;
+        double best_score = 0;
+        bool all_fill = true;
+        for (unsigned img = 0; img < n_imgs; img++) {
+            double code = codes(i, img);
+            if (code != MASK_FILL) all_fill = false;
+            if (code != MASK_CLEAR) continue;
+            unsigned first_col = img * n_bands;
+            bool complete = true;
+            double sum = 0;
+            for (unsigned b = 0; b < n_bands; b++) {
+                double val = vals(i, first_col + b);
+                if (!is_finite(val)) {
+                    complete = false;
+                    break;
+                }
+                sum += val;
+            }
+            if (!complete) continue;
+
+            double score = date_scores(img);
+            if (use_ndvi) {
+                double red = vals(i, first_col + red_band - 1);
+                double nir = vals(i, first_col + nir_band - 1);
+                if (nir + red != 0) score += w_ndvi * (nir - red) / (nir + red);
+            }
+            if (use_brightness) {
+                score -= w_brightness * sum / (n_bands * scale);
+            }
+            if (best < 0 || score > best_score) {
+                best = img;
+                best_score = score;
+            }
+        }
+
+        if (best < 0) {
+            for (unsigned b = 0; b < n_bands + 1; b++) out(i, b) = datum::nan;
+            out(i, n_bands + 1) = all_fill ? MASK_FILL : MASK_CLOUD;
+        } else {
+            for (unsigned b = 0; b < n_bands; b++) {
+                out(i, b) = vals(i, best * n_bands + b);
+            }
+            out(i, n_bands) = best + 1;
+            out(i, n_bands + 1) = MASK_CLEAR;
+        }
+    }
+    return(out);
+}
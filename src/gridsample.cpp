@@ -0,0 +1,92 @@
+#include <RcppArmadillo.h>
+#include <set>
+
+using namespace arma;
+
+// Draw a random integer in [0, n) using the R random number generator
+static double rand_index(double n) {
+    double u = unif_rand();
+    // unif_rand never returns 1, but guard against rounding up to n
+    double i = floor(u * n);
+    return(i < n ? i : n - 1);
+}
+
+//' Draw a random sample from each cell of a grid
+//'
+//' Draws \code{nsamp} pixels from each cell of a grid laid out over an image,
+//' without building the indices of all the pixels in each cell. Samples drawn
+//' without replacement use Floyd's algorithm, so the time taken depends only
+//' on \code{nsamp}, not on the size of the grid cells. Random numbers are
+//' drawn from the R random number generator, so results can be reproduced
+//' with \code{set.seed}. This function is called by the
+//' \code{\link{gridsample}} function. It is not intended to be used directly.
+//'
+//' @param nrows number of rows in the image
+//' @param ncols number of columns in the image
+//' @param row_start first row (1 based) of each row of grid cells
+//' @param row_end last row (1 based) of each row of grid cells
+//' @param col_start first column (1 based) of each column of grid cells
+//' @param col_end last column (1 based) of each column of grid cells
+//' @param nsamp how many samples to draw from each grid cell
+//' @param rowmajor whether to return indices in row-major format (otherwise
+//' column-major)
+//' @param replace whether to sample with replacement (within each grid cell)
+//' @return vector of sample indices (1 based), ordered by grid cell (with
+//' the grid cells ordered by row)
+// [[Rcpp::export]]
+Rcpp::NumericVector gridsample_cells(double nrows, double ncols,
+        arma::vec& row_start, arma::vec& row_end, arma::vec& col_start,
+        arma::vec& col_end, int nsamp, bool rowmajor=false,
+        bool replace=false) {
+    if (row_start.n_elem != row_end.n_elem ||
+            col_start.n_elem != col_end.n_elem) {
+        Rcpp::stop("grid cell starts and ends must have the same length");
+    }
+    if (nsamp < 0) Rcpp::stop("nsamp must be non-negative");
+    Rcpp::NumericVector samp(row_start.n_elem * col_start.n_elem * nsamp);
+    unsigned n = 0;
+    std::set<double> chosen;
+    for (unsigned i = 0; i < row_start.n_elem; i++) {
+        double cell_nrows = row_end(i) - row_start(i) + 1;
+        for (unsigned j = 0; j < col_start.n_elem; j++) {
+            double cell_ncols = col_end(j) - col_start(j) + 1;
+            double cell_n = cell_nrows * cell_ncols;
+            if (!replace && nsamp > cell_n) {
+                Rcpp::stop("cannot take a sample larger than the number of pixels in a grid cell when replace=FALSE");
+            }
+            if (nsamp > 0 && cell_n < 1) {
+                Rcpp::stop("grid cells must contain at least one pixel");
+            }
+            // Offsets (in column-major order within the grid cell) of the
+            // sampled pixels
+            std::vector<double> offsets;
+            offsets.reserve(nsamp);
+            if (replace) {
+                for (int k = 0; k < nsamp; k++) {
+                    offsets.push_back(rand_index(cell_n));
+                }
+            } else {
+                // Floyd's algorithm
+                chosen.clear();
+                for (double k = cell_n - nsamp; k < cell_n; k++) {
+                    double t = rand_index(k + 1);
+                    if (!chosen.insert(t).second) {
+                        chosen.insert(k);
+                        t = k;
+                    }
+                    offsets.push_back(t);
+                }
+            }
+            for (int k = 0; k < nsamp; k++) {
+                double row = row_start(i) - 1 + fmod(offsets[k], cell_nrows);
+                double col = col_start(j) - 1 + floor(offsets[k] / cell_nrows);
+                if (rowmajor) {
+                    samp(n++) = row * ncols + col + 1;
+                } else {
+                    samp(n++) = col * nrows + row + 1;
+                }
+            }
+        }
+    }
+    return(samp);
+}
@@ -0,0 +1,294 @@
+#include <RcppArmadillo.h>
+#include <map>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace arma;
+
+// Number of leading bits of the randomized address used to divide pixels
+// into buckets for the first pass of the GRTS sampler
+const int GRTS_BUCKET_BITS = 16;
+const unsigned GRTS_N_BUCKETS = 1 << GRTS_BUCKET_BITS;
+
+// The 24 permutations of the four quadrants of a quadtree node
+static const unsigned char quad_perms[24][4] = {
+    {0, 1, 2, 3}, {0, 1, 3, 2}, {0, 2, 1, 3}, {0, 2, 3, 1}, {0, 3, 1, 2},
+    {0, 3, 2, 1}, {1, 0, 2, 3}, {1, 0, 3, 2}, {1, 2, 0, 3}, {1, 2, 3, 0},
+    {1, 3, 0, 2}, {1, 3, 2, 0}, {2, 0, 1, 3}, {2, 0, 3, 1}, {2, 1, 0, 3},
+    {2, 1, 3, 0}, {2, 3, 0, 1}, {2, 3, 1, 0}, {3, 0, 1, 2}, {3, 0, 2, 1},
+    {3, 1, 0, 2}, {3, 1, 2, 0}, {3, 2, 0, 1}, {3, 2, 1, 0}
+};
+
+// splitmix64 finalizer, used to hash quadtree nodes
+static unsigned long long mix64(unsigned long long z) {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return(z ^ (z >> 31));
+}
+
+// Calculates the randomized quadtree address of a pixel. The quadtree
+// address interleaves the bits of the row and column numbers (two bits, or
+// one quadrant, per level), and is randomized by permuting the quadrants of
+// every node of the quadtree. The permutation for each node is chosen by
+// hashing the node address with the seed, so no per-node state is stored.
+// Consecutive pixels share most of their address, so the randomized prefix
+// of the last pixel is reused, and only the levels that differ are hashed.
+struct grts_addresser {
+    int n_levels;
+    std::vector<unsigned long long> level_keys;
+    unsigned long long last;
+    bool has_last;
+    // rand_prefix[l] is the randomized address of the first l levels of the
+    // last pixel
+    std::vector<unsigned long long> rand_prefix;
+
+    grts_addresser(int levels, double seed) {
+        n_levels = levels;
+        for (int l = 0; l < n_levels; l++) {
+            level_keys.push_back(mix64((unsigned long long) seed +
+                                       (l + 1) * 0x9E3779B97F4A7C15ULL));
+        }
+        has_last = false;
+        rand_prefix.assign(n_levels + 1, 0);
+    }
+
+    // Randomized address of a pixel (0 based row and column), left aligned
+    // in 64 bits
+    unsigned long long address(unsigned row, unsigned col) {
+        unsigned long long orig = 0;
+        for (int l = 0; l < n_levels; l++) {
+            int b = n_levels - 1 - l;
+            orig = (orig << 2) | (((row >> b) & 1) << 1) | ((col >> b) & 1);
+        }
+        int start = 0;
+        if (has_last) {
+            unsigned long long diff = orig ^ last;
+            if (diff == 0) {
+                start = n_levels;
+            } else {
+                int h = 0;
+                while (diff >>= 1) h++;
+                start = n_levels - 1 - h / 2;
+            }
+        }
+        for (int l = start; l < n_levels; l++) {
+            unsigned long long prefix = orig >> (2 * (n_levels - l));
+            unsigned digit = (orig >> (2 * (n_levels - 1 - l))) & 3;
+            const unsigned char* perm =
+                quad_perms[mix64(prefix ^ level_keys[l]) % 24];
+            rand_prefix[l + 1] = (rand_prefix[l] << 2) | perm[digit];
+        }
+        last = orig;
+        has_last = true;
+        return(rand_prefix[n_levels] << (64 - 2 * n_levels));
+    }
+};
+
+static void check_grts_args(arma::vec& strata, int n_cols, int n_levels) {
+    if (n_cols < 1 || strata.n_elem % n_cols != 0) {
+        Rcpp::stop("length of strata must be a multiple of n_cols");
+    }
+    if (n_levels < 1 || n_levels > 31) {
+        Rcpp::stop("n_levels must be between 1 and 31");
+    }
+}
+
+//' Count pixels by stratum and randomized quadtree address
+//'
+//' First pass of the generalized random tessellation stratified (GRTS)
+//' sampler used by \code{\link{grts_sample}}. Calculates the randomized
+//' quadtree address of each eligible pixel in a block, and counts the pixels
+//' in each stratum by the leading 16 bits of their address. Rows of the block
+//' are processed in parallel when OpenMP is available. This function is
+//' called once per block of pixels. It is not intended to be used directly.
+//'
+//' @param counts the list returned by a previous call to
+//' \code{accum_grts_counts}, or an empty list to start a new accumulation
+//' @param strata the strata of the pixels in this block as a vector, in
+//' row-major order (as returned by \code{getValues}), with ineligible pixels
+//' coded as \code{NA}
+//' @param first_row the row number (1 based) of the first row of the block
+//' @param n_cols number of columns in the image
+//' @param n_levels number of levels in the quadtree (so the image must have
+//' at most \code{2^n_levels} rows and columns)
+//' @param seed seed used to randomize the quadtree addresses
+//' @param n_threads number of threads to use (if 0, use the OpenMP default)
+//' @return a list with elements \code{strata} (the strata seen so far) and
+//' \code{counts} (a matrix with one row per address bucket, and one column
+//' per stratum)
+// [[Rcpp::export]]
+Rcpp::List accum_grts_counts(Rcpp::List counts, arma::vec& strata,
+        double first_row, int n_cols, int n_levels, double seed,
+        int n_threads=0) {
+    check_grts_args(strata, n_cols, n_levels);
+    vec strata_vals;
+    mat bucket_counts;
+    if (counts.size() == 0) {
+        bucket_counts.set_size(GRTS_N_BUCKETS, 0);
+    } else {
+        strata_vals = Rcpp::as<vec>(counts["strata"]);
+        bucket_counts = Rcpp::as<mat>(counts["counts"]);
+        if (bucket_counts.n_rows != GRTS_N_BUCKETS ||
+                bucket_counts.n_cols != strata_vals.n_elem) {
+            Rcpp::stop("counts must be a list as output by accum_grts_counts");
+        }
+    }
+
+    // Index of the stratum of each pixel (-1 for ineligible pixels)
+    std::map<double, int> strata_index;
+    for (unsigned i = 0; i < strata_vals.n_elem; i++) {
+        strata_index[strata_vals(i)] = i;
+    }
+    std::vector<int> pixel_stratum(strata.n_elem);
+    for (unsigned i = 0; i < strata.n_elem; i++) {
+        double val = strata(i);
+        if (!is_finite(val)) {
+            pixel_stratum[i] = -1;
+            continue;
+        }
+        std::map<double, int>::iterator it = strata_index.find(val);
+        if (it == strata_index.end()) {
+            int k = strata_vals.n_elem;
+            strata_vals.resize(k + 1);
+            strata_vals(k) = val;
+            bucket_counts.resize(GRTS_N_BUCKETS, k + 1);
+            bucket_counts.col(k).zeros();
+            it = strata_index.insert(std::make_pair(val, k)).first;
+        }
+        pixel_stratum[i] = it->second;
+    }
+
+    unsigned n_strata = strata_vals.n_elem;
+    int n_rows = strata.n_elem / n_cols;
+    int n_thr = 1;
+#ifdef _OPENMP
+    n_thr = n_threads > 0 ? n_threads : omp_get_max_threads();
+#endif
+    std::vector<std::vector<unsigned> > thread_counts(n_thr,
+            std::vector<unsigned>((size_t) GRTS_N_BUCKETS * n_strata, 0));
+    #pragma omp parallel num_threads(n_thr)
+    {
+        int thread_num = 0;
+#ifdef _OPENMP
+        thread_num = omp_get_thread_num();
+#endif
+        std::vector<unsigned>& tc = thread_counts[thread_num];
+        grts_addresser addr(n_levels, seed);
+        #pragma omp for schedule(static)
+        for (int row = 0; row < n_rows; row++) {
+            unsigned img_row = first_row - 1 + row;
+            for (int col = 0; col < n_cols; col++) {
+                int k = pixel_stratum[(size_t) row * n_cols + col];
+                if (k < 0) continue;
+                unsigned bucket = addr.address(img_row, col) >>
+                    (64 - GRTS_BUCKET_BITS);
+                tc[(size_t) k * GRTS_N_BUCKETS + bucket]++;
+            }
+        }
+    }
+    for (int t = 0; t < n_thr; t++) {
+        for (unsigned k = 0; k < n_strata; k++) {
+            for (unsigned b = 0; b < GRTS_N_BUCKETS; b++) {
+                bucket_counts(b, k) +=
+                    thread_counts[t][(size_t) k * GRTS_N_BUCKETS + b];
+            }
+        }
+    }
+
+    return(Rcpp::List::create(Rcpp::Named("strata")=strata_vals,
+                              Rcpp::Named("counts")=bucket_counts));
+}
+
+//' Collect the pixels in selected address buckets
+//'
+//' Second pass of the generalized random tessellation stratified (GRTS)
+//' sampler used by \code{\link{grts_sample}}. Returns the cell number and
+//' randomized quadtree address of each eligible pixel in a block whose
+//' stratum and address bucket (as counted by \code{accum_grts_counts})
+//' contain a sample. Rows of the block are processed in parallel when
+//' OpenMP is available. This function is called once per block of pixels. It
+//' is not intended to be used directly.
+//'
+//' @param strata the strata of the pixels in this block as a vector, in
+//' row-major order (as returned by \code{getValues}), with ineligible pixels
+//' coded as \code{NA}
+//' @param first_row the row number (1 based) of the first row of the block
+//' @param n_cols number of columns in the image
+//' @param n_levels number of levels in the quadtree
+//' @param seed seed used to randomize the quadtree addresses (must match the
+//' seed used for \code{accum_grts_counts})
+//' @param strata_vals the strata, as returned by \code{accum_grts_counts}
+//' @param buckets the selected buckets, coded as
+//' \code{(stratum - 1) * 2^16 + bucket}, where \code{stratum} is the 1 based
+//' index of the stratum in \code{strata_vals} and \code{bucket} is the 0
+//' based bucket number
+//' @param n_threads number of threads to use (if 0, use the OpenMP default)
+//' @return a matrix with one row per selected pixel, and columns giving the
+//' cell number, the bucket code, and the high and low 32 bits of the
+//' randomized address
+// [[Rcpp::export]]
+arma::mat grts_collect(arma::vec& strata, double first_row, int n_cols,
+        int n_levels, double seed, arma::vec& strata_vals, arma::vec& buckets,
+        int n_threads=0) {
+    check_grts_args(strata, n_cols, n_levels);
+    std::map<double, int> strata_index;
+    for (unsigned i = 0; i < strata_vals.n_elem; i++) {
+        strata_index[strata_vals(i)] = i;
+    }
+    std::vector<bool> selected((size_t) GRTS_N_BUCKETS * strata_vals.n_elem,
+                               false);
+    for (unsigned i = 0; i < buckets.n_elem; i++) {
+        if (buckets(i) < 0 || buckets(i) >= selected.size()) {
+            Rcpp::stop("bucket code out of range");
+        }
+        selected[(size_t) buckets(i)] = true;
+    }
+
+    int n_rows = strata.n_elem / n_cols;
+    int n_thr = 1;
+#ifdef _OPENMP
+    n_thr = n_threads > 0 ? n_threads : omp_get_max_threads();
+#endif
+    std::vector<std::vector<double> > found(n_thr);
+    #pragma omp parallel num_threads(n_thr)
+    {
+        int thread_num = 0;
+#ifdef _OPENMP
+        thread_num = omp_get_thread_num();
+#endif
+        std::vector<double>& f = found[thread_num];
+        grts_addresser addr(n_levels, seed);
+        #pragma omp for schedule(static)
+        for (int row = 0; row < n_rows; row++) {
+            unsigned img_row = first_row - 1 + row;
+            for (int col = 0; col < n_cols; col++) {
+                double val = strata[(size_t) row * n_cols + col];
+                if (!is_finite(val)) continue;
+                std::map<double, int>::const_iterator it =
+                    strata_index.find(val);
+                if (it == strata_index.end()) continue;
+                unsigned long long a = addr.address(img_row, col);
+                size_t code = (size_t) it->second * GRTS_N_BUCKETS +
+                    (a >> (64 - GRTS_BUCKET_BITS));
+                if (!selected[code]) continue;
+                f.push_back((double) img_row * n_cols + col + 1);
+                f.push_back(code);
+                f.push_back(a >> 32);
+                f.push_back(a & 0xFFFFFFFFULL);
+            }
+        }
+    }
+
+    unsigned n_found = 0;
+    for (int t = 0; t < n_thr; t++) n_found += found[t].size() / 4;
+    mat out(n_found, 4);
+    unsigned n = 0;
+    for (int t = 0; t < n_thr; t++) {
+        for (size_t i = 0; i < found[t].size(); i += 4) {
+            for (unsigned j = 0; j < 4; j++) out(n, j) = found[t][i + j];
+            n++;
+        }
+    }
+    return(out);
+}
@@ -0,0 +1,96 @@
+#ifndef TEAMLUCC_MAPPED_FILE_H
+#define TEAMLUCC_MAPPED_FILE_H
+
+#include <Rcpp.h>
+#include <string>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOGDI
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Read-only memory mapping of a whole file. The mapping is released when the
+// object goes out of scope. Errors are raised with Rcpp::stop, so objects
+// must only be constructed from the main thread.
+class mapped_file {
+public:
+    mapped_file(const std::string& filename) : data_(NULL), size_(0) {
+#ifdef _WIN32
+        file_ = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                            NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file_ == INVALID_HANDLE_VALUE) {
+            Rcpp::stop("cannot open " + filename);
+        }
+        LARGE_INTEGER file_size;
+        GetFileSizeEx(file_, &file_size);
+        size_ = (size_t) file_size.QuadPart;
+        mapping_ = NULL;
+        if (size_ == 0) return;
+        mapping_ = CreateFileMappingA(file_, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping_ == NULL) {
+            CloseHandle(file_);
+            Rcpp::stop("cannot map " + filename);
+        }
+        data_ = (const char*) MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+        if (data_ == NULL) {
+            CloseHandle(mapping_);
+            CloseHandle(file_);
+            Rcpp::stop("cannot map " + filename);
+        }
+#else
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            Rcpp::stop("cannot open " + filename);
+        }
+        struct stat file_stat;
+        if (fstat(fd, &file_stat) != 0) {
+            close(fd);
+            Rcpp::stop("cannot stat " + filename);
+        }
+        size_ = (size_t) file_stat.st_size;
+        if (size_ > 0) {
+            void* addr = mmap(NULL, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr == MAP_FAILED) {
+                close(fd);
+                Rcpp::stop("cannot map " + filename);
+            }
+            data_ = (const char*) addr;
+        }
+        // The mapping stays valid after the file descriptor is closed
+        close(fd);
+#endif
+    }
+
+    ~mapped_file() {
+#ifdef _WIN32
+        if (data_ != NULL) UnmapViewOfFile(data_);
+        if (mapping_ != NULL) CloseHandle(mapping_);
+        CloseHandle(file_);
+#else
+        if (data_ != NULL) munmap((void*) data_, size_);
+#endif
+    }
+
+    const char* data() const { return(data_); }
+    size_t size() const { return(size_); }
+
+private:
+    // Not copyable
+    mapped_file(const mapped_file&);
+    mapped_file& operator=(const mapped_file&);
+
+    const char* data_;
+    size_t size_;
+#ifdef _WIN32
+    HANDLE file_;
+    HANDLE mapping_;
+#endif
+};
+
+#endif
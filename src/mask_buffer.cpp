@@ -0,0 +1,152 @@
+#include <RcppArmadillo.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace arma;
+
+// Squared distance from each point to the nearest point with a finite f,
+// where the squared distance to point q is (p - q)^2 + f(q), using the lower
+// envelope of parabolas of Felzenszwalb and Huttenlocher. v and z are work
+// arrays of length n and n + 1. Points with no finite f are given inf.
+static void edt_1d(const double* f, double* d, int n, double inf, int* v,
+        double* z) {
+    int k = -1;
+    for (int q = 0; q < n; q++) {
+        if (f[q] >= inf) continue;
+        if (k < 0) {
+            k = 0;
+            v[0] = q;
+            z[0] = -datum::inf;
+            z[1] = datum::inf;
+            continue;
+        }
+        double s;
+        while (true) {
+            s = ((f[q] + (double) q * q) - (f[v[k]] + (double) v[k] * v[k])) /
+                (2.0 * (q - v[k]));
+            if (s <= z[k]) {
+                k--;
+            } else {
+                break;
+            }
+        }
+        k++;
+        v[k] = q;
+        z[k] = s;
+        z[k + 1] = datum::inf;
+    }
+    if (k < 0) {
+        for (int p = 0; p < n; p++) d[p] = inf;
+        return;
+    }
+    k = 0;
+    for (int p = 0; p < n; p++) {
+        while (z[k + 1] < p) k++;
+        d[p] = (double) (p - v[k]) * (p - v[k]) + f[v[k]];
+    }
+}
+
+//' Buffer a mask by a distance, for a band of rows
+//'
+//' Dilates (or erodes) the pixels of a mask coded \code{foreground} by
+//' \code{radius} pixels, using an exact Euclidean distance transform, so the
+//' run time does not depend on the radius. The distance transform is
+//' separable: squared distances to the nearest seed pixel are first found
+//' along each column, and then along each row using the lower envelope of
+//' parabolas. Pixels are read in a band of rows that includes
+//' \code{ceiling(abs(radius))} rows of context (the halo) above and below the
+//' rows that are output, which is all that is needed for exact results. This
+//' function is called by \code{\link{buffer_mask}}, once per block of pixels.
+//' It is not intended to be used directly.
+//'
+//' @param x the mask values for the band of rows, in row-major order (as
+//' returned by \code{getValues})
+//' @param n_rows number of rows in \code{x}
+//' @param n_cols number of columns in \code{x}
+//' @param first_row the (0 based) row of \code{x} of the first row to output
+//' @param n_out_rows the number of rows to output
+//' @param radius the buffer distance in pixels. If positive, pixels coded
+//' \code{background} that are within \code{radius} of a pixel coded
+//' \code{foreground} are recoded as \code{foreground}. If negative, pixels
+//' coded \code{foreground} that are within \code{-radius} of a pixel coded
+//' \code{background} are recoded as \code{background}. Pixels with other
+//' values (including \code{NA}) are not changed, and are not treated as
+//' either foreground or background.
+//' @param foreground the code of foreground pixels (for example, clouds)
+//' @param background the code of background pixels (for example, clear
+//' pixels)
+//' @param n_threads number of threads to use (if 0, use the OpenMP default)
+//' @return the buffered mask values of the output rows, in row-major order
+// [[Rcpp::export]]
+Rcpp::NumericVector buffer_mask_block(arma::vec& x, int n_rows, int n_cols,
+        int first_row, int n_out_rows, double radius, double foreground=1,
+        double background=0, int n_threads=0) {
+    if (x.n_elem != (unsigned) n_rows * n_cols) {
+        Rcpp::stop("length of x does not match n_rows and n_cols");
+    }
+    if (first_row < 0 || n_out_rows < 0 || first_row + n_out_rows > n_rows) {
+        Rcpp::stop("output rows must be within x");
+    }
+    // Dilation grows the foreground into the background, and erosion grows
+    // the background into the foreground
+    double seed = radius >= 0 ? foreground : background;
+    double target = radius >= 0 ? background : foreground;
+    double max_d2 = radius * radius;
+    double inf = (double) n_rows * n_rows + (double) n_cols * n_cols + 1;
+
+    int n_thr = 1;
+#ifdef _OPENMP
+    n_thr = n_threads > 0 ? n_threads : omp_get_max_threads();
+#endif
+
+    // Squared distances to the nearest seed in the same column, stored
+    // row-major
+    std::vector<double> col_d2(x.n_elem);
+    Rcpp::NumericVector out(n_out_rows * n_cols);
+    double* out_vals = out.begin();
+    #pragma omp parallel num_threads(n_thr)
+    {
+        #pragma omp for schedule(static)
+        for (int col = 0; col < n_cols; col++) {
+            double d = inf;
+            for (int row = 0; row < n_rows; row++) {
+                if (x(row * n_cols + col) == seed) {
+                    d = 0;
+                } else if (d < inf) {
+                    d++;
+                }
+                col_d2[row * n_cols + col] = d;
+            }
+            d = inf;
+            for (int row = n_rows - 1; row >= 0; row--) {
+                if (x(row * n_cols + col) == seed) {
+                    d = 0;
+                } else if (d < inf) {
+                    d++;
+                }
+                double& this_d2 = col_d2[row * n_cols + col];
+                if (d < this_d2) this_d2 = d;
+            }
+        }
+        #pragma omp for schedule(static)
+        for (int i = 0; i < n_rows * n_cols; i++) {
+            if (col_d2[i] < inf) col_d2[i] *= col_d2[i];
+        }
+
+        std::vector<double> d2(n_cols);
+        std::vector<int> v(n_cols);
+        std::vector<double> z(n_cols + 1);
+        #pragma omp for schedule(static)
+        for (int out_row = 0; out_row < n_out_rows; out_row++) {
+            int row = first_row + out_row;
+            edt_1d(&col_d2[row * n_cols], &d2[0], n_cols, inf, &v[0], &z[0]);
+            for (int col = 0; col < n_cols; col++) {
+                double val = x(row * n_cols + col);
+                if (val == target && d2[col] <= max_d2) val = seed;
+                out_vals[out_row * n_cols + col] = val;
+            }
+        }
+    }
+    return(out);
+}
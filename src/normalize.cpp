@@ -0,0 +1,271 @@
+#include <RcppArmadillo.h>
+
+using namespace arma;
+
+// Columns of the moments matrix used by accum_norm_moments and
+// calc_norm_models (one row per band). "y" is the image being normalized
+// (the predictor) and "x" is the base image (the response).
+enum {
+    MOM_N = 0,
+    MOM_MEAN_Y,
+    MOM_MEAN_X,
+    MOM_SYY,
+    MOM_SXX,
+    MOM_SXY,
+    MOM_MIN_Y,
+    MOM_MAX_Y,
+    MOM_MIN_X,
+    MOM_MAX_X,
+    MOM_NCOLS
+};
+
+//' Accumulate moments for model II regression of one image on another
+//'
+//' Updates running means, sums of squares, sums of cross-products, and ranges
+//' for each band of a pair of images, in a single pass over the pixels. Pixels
+//' that are masked, or that are missing in either image, are skipped. This
+//' function is called by the \code{\link{normalize}} function, once per block
+//' of pixels. It is not intended to be used directly.
+//'
+//' @param moments the matrix returned by a previous call to
+//' \code{accum_norm_moments}, or an empty matrix to start a new accumulation
+//' @param x the base image as a matrix, with pixels in rows and bands in
+//' columns
+//' @param y the image to be normalized as a matrix, with pixels in rows and
+//' bands in columns
+//' @param msk the mask as a vector, with pixels to be excluded coded as 1,
+//' and all other pixels coded as 0. Use an empty vector to include all pixels.
+//' @return matrix of moments with one row per band
+// [[Rcpp::export]]
+arma::mat accum_norm_moments(arma::mat moments, arma::mat& x, arma::mat& y,
+        arma::vec& msk) {
+    if (x.n_rows != y.n_rows || x.n_cols != y.n_cols) {
+        Rcpp::stop("x and y must have the same dimensions");
+    }
+    if (msk.n_elem != 0 && msk.n_elem != x.n_rows) {
+        Rcpp::stop("msk must be empty or have one element per pixel");
+    }
+    if (moments.n_elem == 0) {
+        moments.zeros(x.n_cols, MOM_NCOLS);
+        moments.col(MOM_MIN_Y).fill(datum::inf);
+        moments.col(MOM_MIN_X).fill(datum::inf);
+        moments.col(MOM_MAX_Y).fill(-datum::inf);
+        moments.col(MOM_MAX_X).fill(-datum::inf);
+    } else if (moments.n_rows != x.n_cols || moments.n_cols != MOM_NCOLS) {
+        Rcpp::stop("moments does not match the number of bands in x and y");
+    }
+
+    for (unsigned band = 0; band < x.n_cols; band++) {
+        double n = moments(band, MOM_N);
+        double mean_y = moments(band, MOM_MEAN_Y);
+        double mean_x = moments(band, MOM_MEAN_X);
+        double Syy = moments(band, MOM_SYY);
+        double Sxx = moments(band, MOM_SXX);
+        double Sxy = moments(band, MOM_SXY);
+        double min_y = moments(band, MOM_MIN_Y);
+        double max_y = moments(band, MOM_MAX_Y);
+        double min_x = moments(band, MOM_MIN_X);
+        double max_x = moments(band, MOM_MAX_X);
+        const double* x_col = x.colptr(band);
+        const double* y_col = y.colptr(band);
+        for (unsigned i = 0; i < x.n_rows; i++) {
+            // Note that a missing mask value (NaN) is also excluded
+            if (msk.n_elem != 0 && !(msk(i) == 0)) continue;
+            double xi = x_col[i];
+            double yi = y_col[i];
+            if (!is_finite(xi) || !is_finite(yi)) continue;
+            // Welford-style update of the means and of the centered sums of
+            // squares and cross-products
+            n++;
+            double dy = yi - mean_y;
+            double dx = xi - mean_x;
+            mean_y += dy / n;
+            mean_x += dx / n;
+            Syy += dy * (yi - mean_y);
+            Sxx += dx * (xi - mean_x);
+            Sxy += dy * (xi - mean_x);
+            if (yi < min_y) min_y = yi;
+            if (yi > max_y) max_y = yi;
+            if (xi < min_x) min_x = xi;
+            if (xi > max_x) max_x = xi;
+        }
+        moments(band, MOM_N) = n;
+        moments(band, MOM_MEAN_Y) = mean_y;
+        moments(band, MOM_MEAN_X) = mean_x;
+        moments(band, MOM_SYY) = Syy;
+        moments(band, MOM_SXX) = Sxx;
+        moments(band, MOM_SXY) = Sxy;
+        moments(band, MOM_MIN_Y) = min_y;
+        moments(band, MOM_MAX_Y) = max_y;
+        moments(band, MOM_MIN_X) = min_x;
+        moments(band, MOM_MAX_X) = max_x;
+    }
+    return(moments);
+}
+
+// Major axis slope given the variances and covariance (predictor first)
+static double ma_slope(double var_y, double var_x, double cov_xy) {
+    if (cov_xy == 0) return(datum::nan);
+    double d = var_x - var_y;
+    return((d + sqrt(d * d + 4 * cov_xy * cov_xy)) / (2 * cov_xy));
+}
+
+//' Calculate model II regression coefficients from accumulated moments
+//'
+//' Calculates the ordinary least squares (OLS), major axis (MA), standard
+//' major axis (SMA), and ranged major axis (RMA) regressions of the base image
+//' on the image to be normalized, using the moments accumulated by
+//' \code{accum_norm_moments}. The coefficients match those given by
+//' \code{lmodel2} (with ranged major axis calculated using
+//' \code{range.x="interval"} and \code{range.y="interval"}). This function is
+//' called by the \code{\link{normalize}} function. It is not intended to be
+//' used directly.
+//'
+//' @param moments a moments matrix as output by \code{accum_norm_moments}
+//' @return \code{data.frame} with columns "band", "Method", "Intercept", and
+//' "Slope", with one row per band and method
+//' @references Legendre, P., and L. Legendre. 1998. Numerical Ecology. 2nd
+//' English edition. Elsevier Science BV, Amsterdam.
+// [[Rcpp::export]]
+Rcpp::DataFrame calc_norm_models(arma::mat& moments) {
+    if (moments.n_cols != MOM_NCOLS) {
+        Rcpp::stop("moments must be a matrix as output by accum_norm_moments");
+    }
+    const char* methods[] = {"OLS", "MA", "SMA", "RMA"};
+    const unsigned n_methods = 4;
+    unsigned n_out = moments.n_rows * n_methods;
+    Rcpp::IntegerVector band_out(n_out);
+    Rcpp::CharacterVector method_out(n_out);
+    Rcpp::NumericVector intercept_out(n_out);
+    Rcpp::NumericVector slope_out(n_out);
+
+    for (unsigned band = 0; band < moments.n_rows; band++) {
+        double n = moments(band, MOM_N);
+        if (n < 2) {
+            Rcpp::stop("too few valid pixels to fit normalization model");
+        }
+        double var_y = moments(band, MOM_SYY) / (n - 1);
+        double var_x = moments(band, MOM_SXX) / (n - 1);
+        double cov_xy = moments(band, MOM_SXY) / (n - 1);
+        double mean_y = moments(band, MOM_MEAN_Y);
+        double mean_x = moments(band, MOM_MEAN_X);
+
+        double slopes[n_methods];
+        slopes[0] = cov_xy / var_y;
+        slopes[1] = ma_slope(var_y, var_x, cov_xy);
+        slopes[2] = (cov_xy < 0 ? -1 : 1) * sqrt(var_x / var_y);
+        // Ranged major axis: major axis on variables divided by their ranges,
+        // with the slope then transformed back to the original units
+        double range_y = moments(band, MOM_MAX_Y) - moments(band, MOM_MIN_Y);
+        double range_x = moments(band, MOM_MAX_X) - moments(band, MOM_MIN_X);
+        if (range_y > 0 && range_x > 0) {
+            slopes[3] = ma_slope(var_y / (range_y * range_y),
+                                 var_x / (range_x * range_x),
+                                 cov_xy / (range_y * range_x)) * range_x / range_y;
+        } else {
+            slopes[3] = datum::nan;
+        }
+
+        for (unsigned m = 0; m < n_methods; m++) {
+            unsigned row = band * n_methods + m;
+            band_out(row) = band + 1;
+            method_out(row) = methods[m];
+            slope_out(row) = slopes[m];
+            intercept_out(row) = mean_x - slopes[m] * mean_y;
+        }
+    }
+
+    return(Rcpp::DataFrame::create(Rcpp::Named("band")=band_out,
+                                   Rcpp::Named("Method")=method_out,
+                                   Rcpp::Named("Intercept")=intercept_out,
+                                   Rcpp::Named("Slope")=slope_out,
+                                   Rcpp::Named("stringsAsFactors")=false));
+}
+
+// Get the range of values that can be stored in a raster package datatype,
+// leaving out the value raster uses as the NA flag for that datatype (the
+// lowest value for signed types, and the highest value for unsigned types).
+// Returns false for floating point datatypes (which are not rounded).
+static bool datatype_range(std::string datatype, double& min_val,
+        double& max_val) {
+    if (datatype == "INT1S") {
+        min_val = -127;
+        max_val = 127;
+    } else if (datatype == "INT1U") {
+        min_val = 0;
+        max_val = 254;
+    } else if (datatype == "INT2S") {
+        min_val = -32767;
+        max_val = 32767;
+    } else if (datatype == "INT2U") {
+        min_val = 0;
+        max_val = 65534;
+    } else if (datatype == "INT4S") {
+        min_val = -2147483647;
+        max_val = 2147483647;
+    } else if (datatype == "INT4U") {
+        min_val = 0;
+        max_val = 4294967294;
+    } else if (datatype == "" || datatype == "FLT4S" || datatype == "FLT8S") {
+        return(false);
+    } else {
+        Rcpp::stop("unrecognized datatype \"" + datatype + "\"");
+    }
+    return(true);
+}
+
+//' Apply per-band normalization models to a block of pixels
+//'
+//' Applies a gain (slope) and offset (intercept) to each band of an image,
+//' copying masked pixels through unchanged from the original image. If an
+//' integer \code{datatype} is given, the normalized values are rounded and
+//' saturated to the range of that datatype, so the output can be written
+//' directly to disk without overflow. This function is called by the
+//' \code{\link{normalize}} function, once per block of pixels. It is not
+//' intended to be used directly.
+//'
+//' @param y the image to be normalized as a matrix, with pixels in rows and
+//' bands in columns
+//' @param slope vector of slopes, one per band
+//' @param intercept vector of intercepts, one per band
+//' @param msk the mask as a vector, with pixels to be copied unchanged coded
+//' as 1, and all other pixels coded as 0. Use an empty vector to normalize all
+//' pixels.
+//' @param datatype the \code{raster} datatype of the output (for example
+//' "INT2S"), or an empty string to skip rounding
+//' @return matrix of normalized pixel values with pixels in rows and bands in
+//' columns
+// [[Rcpp::export]]
+arma::mat apply_norm_models(arma::mat& y, arma::vec& slope,
+        arma::vec& intercept, arma::vec& msk, std::string datatype="") {
+    if (slope.n_elem != y.n_cols || intercept.n_elem != y.n_cols) {
+        Rcpp::stop("slope and intercept must have one element per band");
+    }
+    if (msk.n_elem != 0 && msk.n_elem != y.n_rows) {
+        Rcpp::stop("msk must be empty or have one element per pixel");
+    }
+    double min_val = 0, max_val = 0;
+    bool round_vals = datatype_range(datatype, min_val, max_val);
+
+    mat normed(y.n_rows, y.n_cols);
+    for (unsigned band = 0; band < y.n_cols; band++) {
+        const double* y_col = y.colptr(band);
+        double* normed_col = normed.colptr(band);
+        double b = slope(band);
+        double a = intercept(band);
+        for (unsigned i = 0; i < y.n_rows; i++) {
+            double val = y_col[i];
+            bool masked = msk.n_elem != 0 && is_finite(msk(i)) && msk(i) != 0;
+            if (is_finite(val) && !masked) {
+                val = b * val + a;
+                if (round_vals) {
+                    val = floor(val + 0.5);
+                    if (val < min_val) val = min_val;
+                    if (val > max_val) val = max_val;
+                }
+            }
+            normed_col[i] = val;
+        }
+    }
+    return(normed);
+}
@@ -0,0 +1,403 @@
+#include <Rcpp.h>
+#include <fstream>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include "mapped_file.h"
+
+// Packed masks store 1 or 2 bits per pixel in 32 bit words (held in R
+// integer vectors). Each row of the mask starts on a new word, and the
+// unused (padding) bits at the end of each row are kept at zero, so that
+// whole words can be combined and counted without unpacking. Pixel col of a
+// row is stored in bits (col * bits) % 32 and up of word (col * bits) / 32 of
+// the row.
+//
+// 1 bit masks hold yes/no masks. 2 bit masks hold codes 0 to 2 (for example
+// clear, cloud, and fill), with code 3 used for missing values.
+//
+// Layout of a packed mask file (all values in native byte order):
+//
+//   magic           8 bytes ("TLPKMS01")
+//   n_rows          uint64
+//   n_cols          uint64
+//   bits            uint64
+//   words           n_rows * words per row uint32
+const char PM_MAGIC[] = "TLPKMS01";
+const unsigned PM_MAGIC_LEN = 8;
+const unsigned PM_NA_CODE = 3;
+
+typedef unsigned int pm_word;
+
+static size_t words_per_row(int n_cols, int bits) {
+    return(((size_t) n_cols * bits + 31) / 32);
+}
+
+static void check_layout(int n_cols, int bits) {
+    if (n_cols < 1) Rcpp::stop("n_cols must be positive");
+    if (bits != 1 && bits != 2) Rcpp::stop("bits must be 1 or 2");
+}
+
+static size_t n_mask_rows(const Rcpp::IntegerVector& words, int n_cols,
+        int bits) {
+    check_layout(n_cols, bits);
+    size_t wpr = words_per_row(n_cols, bits);
+    if (words.size() % wpr != 0) {
+        Rcpp::stop("length of words does not match n_cols and bits");
+    }
+    return(words.size() / wpr);
+}
+
+static pm_word get_word(const Rcpp::IntegerVector& words, size_t i) {
+    pm_word w;
+    memcpy(&w, &words[i], sizeof(pm_word));
+    return(w);
+}
+
+static void set_word(Rcpp::IntegerVector& words, size_t i, pm_word w) {
+    memcpy(&words[i], &w, sizeof(pm_word));
+}
+
+// Mask of the bits of the last word of a row that hold pixels
+static pm_word last_word_mask(int n_cols, int bits) {
+    unsigned used = ((size_t) n_cols * bits) % 32;
+    return(used == 0 ? ~(pm_word) 0 : ((pm_word) 1 << used) - 1);
+}
+
+static unsigned popcount(pm_word w) {
+    w = w - ((w >> 1) & 0x55555555U);
+    w = (w & 0x33333333U) + ((w >> 2) & 0x33333333U);
+    w = (w + (w >> 4)) & 0x0F0F0F0FU;
+    return((w * 0x01010101U) >> 24);
+}
+
+// Gather the even bits of a word into its low 16 bits
+static pm_word compress_even_bits(pm_word w) {
+    w &= 0x55555555U;
+    w = (w | (w >> 1)) & 0x33333333U;
+    w = (w | (w >> 2)) & 0x0F0F0F0FU;
+    w = (w | (w >> 4)) & 0x00FF00FFU;
+    w = (w | (w >> 8)) & 0x0000FFFFU;
+    return(w);
+}
+
+// Spread the low 16 bits of a word to its even bits (the inverse of
+// compress_even_bits)
+static pm_word spread_even_bits(pm_word w) {
+    w &= 0x0000FFFFU;
+    w = (w | (w << 8)) & 0x00FF00FFU;
+    w = (w | (w << 4)) & 0x0F0F0F0FU;
+    w = (w | (w << 2)) & 0x33333333U;
+    w = (w | (w << 1)) & 0x55555555U;
+    return(w);
+}
+
+//' Pack a mask into 1 or 2 bits per pixel
+//'
+//' Packs mask codes into 32 bit words, with each row of the mask starting on
+//' a new word. This function is used by the cloud fill functions to hold
+//' cloud and fill masks in memory. It is not intended to be used directly.
+//'
+//' @param vals the mask codes as a vector, in row-major order (as returned by
+//' \code{getValues}). Codes must be 0 or 1 for 1 bit masks, and 0, 1, or 2
+//' for 2 bit masks (where missing values are stored as code 3).
+//' @param n_cols number of columns in the mask
+//' @param bits number of bits per pixel (1 or 2)
+//' @return the packed words, as an integer vector (the values of the
+//' integers are not meaningful in R)
+// [[Rcpp::export]]
+Rcpp::IntegerVector pack_mask(Rcpp::NumericVector vals, int n_cols,
+        int bits) {
+    check_layout(n_cols, bits);
+    if (vals.size() % n_cols != 0) {
+        Rcpp::stop("length of vals must be a multiple of n_cols");
+    }
+    size_t n_rows = vals.size() / n_cols;
+    size_t wpr = words_per_row(n_cols, bits);
+    pm_word max_code = (1 << bits) - 1;
+    std::vector<pm_word> packed(n_rows * wpr, 0);
+    for (size_t row = 0; row < n_rows; row++) {
+        pm_word* row_words = &packed[row * wpr];
+        for (int col = 0; col < n_cols; col++) {
+            double val = vals[row * n_cols + col];
+            pm_word code;
+            if (ISNAN(val)) {
+                if (bits == 1) {
+                    Rcpp::stop("1 bit masks cannot hold missing values");
+                }
+                code = PM_NA_CODE;
+            } else if (val >= 0 && val <= max_code && val == floor(val)) {
+                code = (pm_word) val;
+            } else {
+                Rcpp::stop("mask codes out of range for the number of bits");
+            }
+            size_t bit = (size_t) col * bits;
+            row_words[bit / 32] |= code << (bit % 32);
+        }
+    }
+    Rcpp::IntegerVector words(packed.size());
+    if (packed.size() > 0) {
+        memcpy(&words[0], &packed[0], packed.size() * sizeof(pm_word));
+    }
+    return(words);
+}
+
+//' Unpack a packed mask
+//'
+//' This function is used by the cloud fill functions. It is not intended to
+//' be used directly.
+//'
+//' @param words the packed words, as returned by \code{pack_mask}
+//' @param n_cols number of columns in the mask
+//' @param bits number of bits per pixel (1 or 2)
+//' @return the mask codes as a vector, in row-major order, with code 3 of 2
+//' bit masks returned as \code{NA}
+// [[Rcpp::export]]
+Rcpp::NumericVector unpack_mask(Rcpp::IntegerVector words, int n_cols,
+        int bits) {
+    size_t n_rows = n_mask_rows(words, n_cols, bits);
+    size_t wpr = words_per_row(n_cols, bits);
+    pm_word code_mask = (1 << bits) - 1;
+    Rcpp::NumericVector vals(n_rows * n_cols);
+    for (size_t row = 0; row < n_rows; row++) {
+        for (int col = 0; col < n_cols; col++) {
+            size_t bit = (size_t) col * bits;
+            pm_word code = (get_word(words, row * wpr + bit / 32) >>
+                            (bit % 32)) & code_mask;
+            vals[row * n_cols + col] = (bits == 2 && code == PM_NA_CODE) ?
+                NA_REAL : code;
+        }
+    }
+    return(vals);
+}
+
+//' Find the pixels of a packed mask with a given code
+//'
+//' Compares whole words of a packed mask with a code, without unpacking the
+//' mask. This function is used by the cloud fill functions. It is not
+//' intended to be used directly.
+//'
+//' @param words the packed words, as returned by \code{pack_mask}
+//' @param n_cols number of columns in the mask
+//' @param bits number of bits per pixel (1 or 2)
+//' @param code the code to find (use 3 to find missing values in 2 bit
+//' masks)
+//' @return a 1 bit packed mask with pixels equal to \code{code} coded as 1
+// [[Rcpp::export]]
+Rcpp::IntegerVector packed_mask_equal(Rcpp::IntegerVector words, int n_cols,
+        int bits, int code) {
+    size_t n_rows = n_mask_rows(words, n_cols, bits);
+    if (code < 0 || code >= (1 << bits)) {
+        Rcpp::stop("code out of range for the number of bits");
+    }
+    size_t wpr_in = words_per_row(n_cols, bits);
+    size_t wpr_out = words_per_row(n_cols, 1);
+    pm_word last_mask = last_word_mask(n_cols, 1);
+    Rcpp::IntegerVector out(n_rows * wpr_out);
+    for (size_t row = 0; row < n_rows; row++) {
+        for (size_t j = 0; j < wpr_out; j++) {
+            pm_word w;
+            if (bits == 1) {
+                w = get_word(words, row * wpr_in + j);
+                if (code == 0) w = ~w;
+            } else {
+                // Pairs of bits that match the code give 11 in m
+                pm_word pattern = code * 0x55555555U;
+                pm_word lo = 0, hi = 0;
+                pm_word m = ~(get_word(words, row * wpr_in + 2 * j) ^ pattern);
+                lo = compress_even_bits(m & (m >> 1));
+                if (2 * j + 1 < wpr_in) {
+                    m = ~(get_word(words, row * wpr_in + 2 * j + 1) ^ pattern);
+                    hi = compress_even_bits(m & (m >> 1));
+                }
+                w = lo | (hi << 16);
+            }
+            if (j == wpr_out - 1) w &= last_mask;
+            set_word(out, row * wpr_out + j, w);
+        }
+    }
+    return(out);
+}
+
+//' Combine two 1 bit packed masks
+//'
+//' Combines two 1 bit packed masks of the same size a whole word at a time.
+//' This function is used by the cloud fill functions. It is not intended to
+//' be used directly.
+//'
+//' @param a the first mask, as returned by \code{pack_mask} or
+//' \code{packed_mask_equal}
+//' @param b the second mask
+//' @param op the operation: "and", "or", "xor", or "andnot" (pixels in
+//' \code{a} but not in \code{b})
+//' @return the combined mask
+// [[Rcpp::export]]
+Rcpp::IntegerVector packed_mask_op(Rcpp::IntegerVector a,
+        Rcpp::IntegerVector b, std::string op) {
+    if (a.size() != b.size()) Rcpp::stop("masks must be the same size");
+    int op_code;
+    if (op == "and") {
+        op_code = 0;
+    } else if (op == "or") {
+        op_code = 1;
+    } else if (op == "xor") {
+        op_code = 2;
+    } else if (op == "andnot") {
+        op_code = 3;
+    } else {
+        Rcpp::stop("unrecognized op \"" + op + "\"");
+    }
+    Rcpp::IntegerVector out(a.size());
+    for (R_xlen_t i = 0; i < a.size(); i++) {
+        pm_word x = get_word(a, i), y = get_word(b, i), w;
+        switch (op_code) {
+            case 0: w = x & y; break;
+            case 1: w = x | y; break;
+            case 2: w = x ^ y; break;
+            default: w = x & ~y; break;
+        }
+        set_word(out, i, w);
+    }
+    return(out);
+}
+
+//' Invert a 1 bit packed mask
+//'
+//' This function is used by the cloud fill functions. It is not intended to
+//' be used directly.
+//'
+//' @param words the packed words, as returned by \code{pack_mask}
+//' @param n_cols number of columns in the mask
+//' @return the inverted mask (with the padding bits at the end of each row
+//' left at zero)
+// [[Rcpp::export]]
+Rcpp::IntegerVector packed_mask_not(Rcpp::IntegerVector words, int n_cols) {
+    size_t n_rows = n_mask_rows(words, n_cols, 1);
+    size_t wpr = words_per_row(n_cols, 1);
+    pm_word last_mask = last_word_mask(n_cols, 1);
+    Rcpp::IntegerVector out(words.size());
+    for (size_t row = 0; row < n_rows; row++) {
+        for (size_t j = 0; j < wpr; j++) {
+            pm_word w = ~get_word(words, row * wpr + j);
+            if (j == wpr - 1) w &= last_mask;
+            set_word(out, row * wpr + j, w);
+        }
+    }
+    return(out);
+}
+
+//' Count the pixels set in a 1 bit packed mask
+//'
+//' This function is used by the cloud fill functions. It is not intended to
+//' be used directly.
+//'
+//' @param words the packed words, as returned by \code{pack_mask}
+//' @return the number of pixels coded as 1
+// [[Rcpp::export]]
+double packed_mask_count(Rcpp::IntegerVector words) {
+    double n = 0;
+    for (R_xlen_t i = 0; i < words.size(); i++) {
+        n += popcount(get_word(words, i));
+    }
+    return(n);
+}
+
+//' Set the code of selected pixels of a 2 bit packed mask
+//'
+//' This function is used by the cloud fill functions. It is not intended to
+//' be used directly.
+//'
+//' @param words the packed words of a 2 bit mask, as returned by
+//' \code{pack_mask}
+//' @param n_cols number of columns in the mask
+//' @param where a 1 bit packed mask of the same size, with the pixels to set
+//' coded as 1
+//' @param code the code to set (0 to 3)
+//' @return the updated 2 bit mask
+// [[Rcpp::export]]
+Rcpp::IntegerVector packed_mask_set(Rcpp::IntegerVector words, int n_cols,
+        Rcpp::IntegerVector where, int code) {
+    size_t n_rows = n_mask_rows(words, n_cols, 2);
+    if (n_mask_rows(where, n_cols, 1) != n_rows) {
+        Rcpp::stop("masks must be the same size");
+    }
+    if (code < 0 || code > 3) Rcpp::stop("code must be between 0 and 3");
+    size_t wpr_in = words_per_row(n_cols, 2);
+    size_t wpr_sel = words_per_row(n_cols, 1);
+    pm_word pattern = code * 0x55555555U;
+    Rcpp::IntegerVector out(words.size());
+    for (size_t row = 0; row < n_rows; row++) {
+        for (size_t j = 0; j < wpr_in; j++) {
+            pm_word sel = get_word(where, row * wpr_sel + j / 2);
+            if (j % 2) sel >>= 16;
+            sel = spread_even_bits(sel);
+            sel |= sel << 1;
+            pm_word w = get_word(words, row * wpr_in + j);
+            set_word(out, row * wpr_in + j, (w & ~sel) | (pattern & sel));
+        }
+    }
+    return(out);
+}
+
+//' Write a packed mask to disk
+//'
+//' This function is used by the cloud fill functions. It is not intended to
+//' be used directly.
+//'
+//' @param filename the file to write
+//' @param words the packed words, as returned by \code{pack_mask}
+//' @param n_cols number of columns in the mask
+//' @param bits number of bits per pixel (1 or 2)
+//' @return nothing (the mask is written to \code{filename})
+// [[Rcpp::export]]
+void write_packed_mask(std::string filename, Rcpp::IntegerVector words,
+        int n_cols, int bits) {
+    unsigned long long hdr[3];
+    hdr[0] = n_mask_rows(words, n_cols, bits);
+    hdr[1] = n_cols;
+    hdr[2] = bits;
+    std::ofstream out(filename.c_str(), std::ios::out | std::ios::binary);
+    if (!out) {
+        Rcpp::stop("cannot open " + filename + " for writing");
+    }
+    out.write(PM_MAGIC, PM_MAGIC_LEN);
+    out.write((const char*) hdr, sizeof(hdr));
+    if (words.size() > 0) {
+        out.write((const char*) &words[0], words.size() * sizeof(pm_word));
+    }
+    if (!out) {
+        Rcpp::stop("error writing " + filename);
+    }
+}
+
+//' Read a packed mask from disk
+//'
+//' Memory-maps a packed mask file written by \code{write_packed_mask}. This
+//' function is used by the cloud fill functions. It is not intended to be
+//' used directly.
+//'
+//' @param filename the file to read
+//' @return list with elements "words", "n_rows", "n_cols", and "bits"
+// [[Rcpp::export]]
+Rcpp::List read_packed_mask(std::string filename) {
+    mapped_file f(filename);
+    unsigned long long hdr[3];
+    if (f.size() < PM_MAGIC_LEN + sizeof(hdr) ||
+            memcmp(f.data(), PM_MAGIC, PM_MAGIC_LEN) != 0) {
+        Rcpp::stop(filename + " is not a packed mask file");
+    }
+    memcpy(hdr, f.data() + PM_MAGIC_LEN, sizeof(hdr));
+    check_layout(hdr[1], hdr[2]);
+    size_t n_words = hdr[0] * words_per_row(hdr[1], hdr[2]);
+    if (f.size() != PM_MAGIC_LEN + sizeof(hdr) + n_words * sizeof(pm_word)) {
+        Rcpp::stop(filename + " is truncated or corrupt");
+    }
+    Rcpp::IntegerVector words(n_words);
+    if (n_words > 0) {
+        memcpy(&words[0], f.data() + PM_MAGIC_LEN + sizeof(hdr),
+               n_words * sizeof(pm_word));
+    }
+    return(Rcpp::List::create(Rcpp::Named("words")=words,
+                              Rcpp::Named("n_rows")=(double) hdr[0],
+                              Rcpp::Named("n_cols")=(double) hdr[1],
+                              Rcpp::Named("bits")=(double) hdr[2]));
+}
@@ -0,0 +1,225 @@
+#include <Rcpp.h>
+#include <fstream>
+#include <cstring>
+#include "mapped_file.h"
+
+// Layout of a pixel store file (all values in native byte order):
+//
+//   magic           8 bytes ("TLPXST01")
+//   n_rows          uint64
+//   n_cols          uint64
+//   column types    n_cols bytes (PS_DOUBLE or PS_INT), padded to a multiple
+//                   of 8 bytes
+//   columns         n_cols columns of n_rows values each (8 bytes per value
+//                   for PS_DOUBLE, 4 bytes for PS_INT)
+//   class codes     n_rows int32
+//   polygon index   n_rows int32
+//
+// Integer columns use the R integer NA value, so missing values round trip.
+const char PS_MAGIC[] = "TLPXST01";
+const unsigned PS_MAGIC_LEN = 8;
+enum {
+    PS_DOUBLE = 0,
+    PS_INT = 1
+};
+
+struct pixel_store_header {
+    unsigned long long n_rows;
+    unsigned long long n_cols;
+    std::vector<unsigned char> types;
+    // Byte offset of each column, followed by the offsets of the class code
+    // and polygon index columns
+    std::vector<size_t> offsets;
+};
+
+static size_t col_width(unsigned char type) {
+    return(type == PS_DOUBLE ? sizeof(double) : sizeof(int));
+}
+
+static size_t padded(size_t n) {
+    return((n + 7) / 8 * 8);
+}
+
+static void calc_offsets(pixel_store_header& hdr) {
+    size_t offset = PS_MAGIC_LEN + 2 * sizeof(unsigned long long) +
+        padded(hdr.n_cols);
+    hdr.offsets.resize(hdr.n_cols + 2);
+    for (unsigned j = 0; j < hdr.n_cols; j++) {
+        hdr.offsets[j] = offset;
+        offset += hdr.n_rows * col_width(hdr.types[j]);
+    }
+    hdr.offsets[hdr.n_cols] = offset;
+    hdr.offsets[hdr.n_cols + 1] = offset + hdr.n_rows * sizeof(int);
+}
+
+static pixel_store_header read_header(const mapped_file& f) {
+    pixel_store_header hdr;
+    size_t fixed = PS_MAGIC_LEN + 2 * sizeof(unsigned long long);
+    if (f.size() < fixed || memcmp(f.data(), PS_MAGIC, PS_MAGIC_LEN) != 0) {
+        Rcpp::stop("not a pixel store file");
+    }
+    memcpy(&hdr.n_rows, f.data() + PS_MAGIC_LEN, sizeof(unsigned long long));
+    memcpy(&hdr.n_cols, f.data() + PS_MAGIC_LEN + sizeof(unsigned long long),
+           sizeof(unsigned long long));
+    if (f.size() < fixed + padded(hdr.n_cols)) {
+        Rcpp::stop("pixel store file is truncated");
+    }
+    hdr.types.assign(f.data() + fixed, f.data() + fixed + hdr.n_cols);
+    calc_offsets(hdr);
+    if (f.size() < hdr.offsets[hdr.n_cols + 1] + hdr.n_rows * sizeof(int)) {
+        Rcpp::stop("pixel store file is truncated");
+    }
+    return(hdr);
+}
+
+//' Write pixel data to a column store file
+//'
+//' Writes the predictor columns, class codes, and polygon indices of a
+//' \code{pixel_data} object to a binary file with one contiguous block per
+//' column, so that the file can later be memory-mapped and read by column
+//' and row index. This function is called by the
+//' \code{\link{save_pixel_data}} function. It is not intended to be used
+//' directly.
+//'
+//' @param filename the file to write
+//' @param cols list of predictor columns (numeric or integer vectors of
+//' equal length)
+//' @param y the class code of each row
+//' @param poly the polygon index of each row
+// [[Rcpp::export]]
+void write_pixel_store(std::string filename, Rcpp::List cols,
+        Rcpp::IntegerVector y, Rcpp::IntegerVector poly) {
+    pixel_store_header hdr;
+    hdr.n_rows = y.size();
+    hdr.n_cols = cols.size();
+    if (poly.size() != y.size()) {
+        Rcpp::stop("y and poly must be the same length");
+    }
+    for (unsigned j = 0; j < hdr.n_cols; j++) {
+        SEXP col = cols[j];
+        if (Rf_length(col) != (int) hdr.n_rows) {
+            Rcpp::stop("all columns must have one element per row");
+        }
+        if (TYPEOF(col) == INTSXP) {
+            hdr.types.push_back(PS_INT);
+        } else if (TYPEOF(col) == REALSXP) {
+            hdr.types.push_back(PS_DOUBLE);
+        } else {
+            Rcpp::stop("columns must be numeric or integer vectors");
+        }
+    }
+
+    std::ofstream out(filename.c_str(), std::ios::out | std::ios::binary);
+    if (!out) {
+        Rcpp::stop("cannot open " + filename + " for writing");
+    }
+    out.write(PS_MAGIC, PS_MAGIC_LEN);
+    out.write((const char*) &hdr.n_rows, sizeof(unsigned long long));
+    out.write((const char*) &hdr.n_cols, sizeof(unsigned long long));
+    std::vector<char> types(padded(hdr.n_cols), 0);
+    for (unsigned j = 0; j < hdr.n_cols; j++) types[j] = hdr.types[j];
+    if (types.size() > 0) out.write(&types[0], types.size());
+    for (unsigned j = 0; j < hdr.n_cols; j++) {
+        SEXP col = cols[j];
+        if (hdr.types[j] == PS_INT) {
+            out.write((const char*) INTEGER(col), hdr.n_rows * sizeof(int));
+        } else {
+            out.write((const char*) REAL(col), hdr.n_rows * sizeof(double));
+        }
+    }
+    out.write((const char*) y.begin(), hdr.n_rows * sizeof(int));
+    out.write((const char*) poly.begin(), hdr.n_rows * sizeof(int));
+    if (!out) {
+        Rcpp::stop("error writing " + filename);
+    }
+}
+
+//' Read rows from a pixel store file
+//'
+//' Memory-maps a pixel store file written by \code{write_pixel_store} and
+//' gathers the requested rows from each column, so that only the pages
+//' holding those rows are read from disk. This function is called by the
+//' \code{\link{load_pixel_data}} function. It is not intended to be used
+//' directly.
+//'
+//' @param filename the file to read
+//' @param rows the (1 based) rows to read. If empty, all rows are read.
+//' @return list with elements "x" (a list of predictor columns), "y" (the
+//' class codes), and "poly" (the polygon indices)
+// [[Rcpp::export]]
+Rcpp::List read_pixel_store(std::string filename, Rcpp::NumericVector rows) {
+    mapped_file f(filename);
+    pixel_store_header hdr = read_header(f);
+
+    bool all_rows = rows.size() == 0;
+    size_t n_out = all_rows ? hdr.n_rows : rows.size();
+    std::vector<size_t> index(n_out);
+    for (size_t i = 0; i < n_out; i++) {
+        if (all_rows) {
+            index[i] = i;
+        } else {
+            if (!(rows[i] >= 1 && rows[i] <= hdr.n_rows)) {
+                Rcpp::stop("rows out of range");
+            }
+            index[i] = (size_t) rows[i] - 1;
+        }
+    }
+
+    Rcpp::List x(hdr.n_cols);
+    for (unsigned j = 0; j < hdr.n_cols; j++) {
+        const char* col = f.data() + hdr.offsets[j];
+        if (hdr.types[j] == PS_INT) {
+            Rcpp::IntegerVector out(n_out);
+            for (size_t i = 0; i < n_out; i++) {
+                memcpy(&out[i], col + index[i] * sizeof(int), sizeof(int));
+            }
+            x[j] = out;
+        } else {
+            Rcpp::NumericVector out(n_out);
+            for (size_t i = 0; i < n_out; i++) {
+                memcpy(&out[i], col + index[i] * sizeof(double),
+                       sizeof(double));
+            }
+            x[j] = out;
+        }
+    }
+    Rcpp::IntegerVector y(n_out);
+    Rcpp::IntegerVector poly(n_out);
+    const char* y_col = f.data() + hdr.offsets[hdr.n_cols];
+    const char* poly_col = f.data() + hdr.offsets[hdr.n_cols + 1];
+    for (size_t i = 0; i < n_out; i++) {
+        memcpy(&y[i], y_col + index[i] * sizeof(int), sizeof(int));
+        memcpy(&poly[i], poly_col + index[i] * sizeof(int), sizeof(int));
+    }
+
+    return(Rcpp::List::create(Rcpp::Named("x")=x,
+                              Rcpp::Named("y")=y,
+                              Rcpp::Named("poly")=poly));
+}
+
+//' Read the class codes and polygon indices of a pixel store file
+//'
+//' Reads only the class code and polygon index columns of a pixel store
+//' file, for use in selecting rows by class and linking rows to their source
+//' polygons without reading the predictors. This function is called by the
+//' \code{\link{load_pixel_data}} function. It is not intended to be used
+//' directly.
+//'
+//' @param filename the file to read
+//' @return list with elements "y" (the class codes) and "poly" (the polygon
+//' indices)
+// [[Rcpp::export]]
+Rcpp::List read_pixel_store_index(std::string filename) {
+    mapped_file f(filename);
+    pixel_store_header hdr = read_header(f);
+    Rcpp::IntegerVector y(hdr.n_rows);
+    Rcpp::IntegerVector poly(hdr.n_rows);
+    if (hdr.n_rows > 0) {
+        memcpy(y.begin(), f.data() + hdr.offsets[hdr.n_cols],
+               hdr.n_rows * sizeof(int));
+        memcpy(poly.begin(), f.data() + hdr.offsets[hdr.n_cols + 1],
+               hdr.n_rows * sizeof(int));
+    }
+    return(Rcpp::List::create(Rcpp::Named("y")=y,
+                              Rcpp::Named("poly")=poly));
+}
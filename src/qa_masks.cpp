@@ -0,0 +1,98 @@
+#include <RcppArmadillo.h>
+
+using namespace arma;
+
+// Columns of the QA band matrix passed to decode_qa_masks (in the order of
+// the mask stack made by auto_preprocess_landsat)
+enum {
+    QA_FILL = 0,
+    QA_FMASK,
+    QA_CLOUD,
+    QA_CLOUD_SHADOW,
+    QA_ADJACENT_CLOUD
+};
+
+// fmask codes
+const double FMASK_CLOUD_SHADOW = 2;
+const double FMASK_CLOUD = 4;
+const double FMASK_FILL = 255;
+
+// Combine a set of conditions the way R does for "|": true if any condition
+// is true, missing if none are true but any are missing, and false otherwise
+static double any_true(const double* vals, const double* codes, int n) {
+    bool missing = false;
+    for (int i = 0; i < n; i++) {
+        if (!is_finite(vals[i])) {
+            missing = true;
+        } else if (vals[i] == codes[i]) {
+            return(1);
+        }
+    }
+    return(missing ? datum::nan : 0);
+}
+
+//' Decode Landsat QA bands into cloud and fill masks
+//'
+//' Decodes the fill, fmask, and 6S (LEDAPS) cloud QA bands for a block of
+//' pixels in a single pass, giving the cloud mask, the fill mask, and the
+//' fmask class of each pixel. This function is called by
+//' \code{calc_qa_masks}, once per block of pixels. It is not intended to be
+//' used directly.
+//'
+//' @param qa the QA bands as a matrix, with pixels in rows, and bands in
+//' columns in the order fill_QA, fmask, cloud_QA, cloud_shadow_QA,
+//' adjacent_cloud_QA. Only the first two columns are needed if
+//' \code{mask_type} is "fmask".
+//' @param mask_type the cloud mask to use: "fmask" (fmask cloud and cloud
+//' shadow), "6S" (the cloud_QA, cloud_shadow_QA, and adjacent_cloud_QA
+//' bands), or "both" (any of these)
+//' @return matrix with one row per pixel, and three columns: the cloud mask
+//' (clouds, cloud shadows, and fill coded as 1, other pixels coded as 0), the
+//' fill mask (fill coded as 1, other pixels coded as 0), and the fmask class.
+//' Pixels where the masks cannot be determined because of missing QA values
+//' are coded as \code{NA}.
+// [[Rcpp::export]]
+arma::mat decode_qa_masks(arma::mat& qa, std::string mask_type="fmask") {
+    bool use_fmask = mask_type == "fmask" || mask_type == "both";
+    bool use_6S = mask_type == "6S" || mask_type == "both";
+    if (!use_fmask && !use_6S) {
+        Rcpp::stop("unrecognized option \"" + mask_type + "\" for mask_type");
+    }
+    if (qa.n_cols < (use_6S ? 5 : 2)) {
+        Rcpp::stop("qa does not have the bands needed for this mask_type");
+    }
+
+    // Conditions tested for the cloud mask (fill is tested on the fmask band
+    // unless only the 6S mask is used)
+    std::vector<int> cloud_bands;
+    std::vector<double> cloud_codes;
+    int fill_band = use_fmask ? QA_FMASK : QA_FILL;
+    if (use_fmask) {
+        cloud_bands.push_back(QA_FMASK);
+        cloud_codes.push_back(FMASK_CLOUD_SHADOW);
+        cloud_bands.push_back(QA_FMASK);
+        cloud_codes.push_back(FMASK_CLOUD);
+    }
+    if (use_6S) {
+        cloud_bands.push_back(QA_CLOUD);
+        cloud_codes.push_back(255);
+        cloud_bands.push_back(QA_CLOUD_SHADOW);
+        cloud_codes.push_back(255);
+        cloud_bands.push_back(QA_ADJACENT_CLOUD);
+        cloud_codes.push_back(255);
+    }
+    cloud_bands.push_back(fill_band);
+    cloud_codes.push_back(use_fmask ? FMASK_FILL : 255);
+    int n_cond = cloud_bands.size();
+
+    mat masks(qa.n_rows, 3);
+    std::vector<double> vals(n_cond);
+    for (unsigned i = 0; i < qa.n_rows; i++) {
+        for (int k = 0; k < n_cond; k++) vals[k] = qa(i, cloud_bands[k]);
+        masks(i, 0) = any_true(&vals[0], &cloud_codes[0], n_cond);
+        // The fill test is the last condition
+        masks(i, 1) = any_true(&vals[n_cond - 1], &cloud_codes[n_cond - 1], 1);
+        masks(i, 2) = qa(i, QA_FMASK);
+    }
+    return(masks);
+}
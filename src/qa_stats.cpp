@@ -0,0 +1,71 @@
+#include <RcppArmadillo.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace arma;
+
+// QA bands are 8 bit, so each band is counted into a fixed histogram with one
+// bin per possible value
+const unsigned QA_N_BINS = 256;
+
+//' Accumulate histograms of Landsat QA bands
+//'
+//' Counts the values of each QA band (for example, the fill_QA and fmask
+//' bands) in a block of pixels, in a single pass, using a fixed histogram of
+//' 256 bins per band. Counts are made in one histogram per thread, which are
+//' summed at the end of the pass. Missing values are skipped (separately for
+//' each band). This function is called by \code{\link{auto_QA_stats}}, once
+//' per block of pixels. It is not intended to be used directly.
+//'
+//' @param hist the matrix returned by a previous call to
+//' \code{accum_qa_hist}, or an empty matrix to start a new accumulation
+//' @param qa the QA band values as a matrix, with pixels in rows and bands in
+//' columns. Values must be integers between 0 and 255.
+//' @param n_threads number of threads to use (if 0, use the OpenMP default)
+//' @return matrix of counts with 256 rows (the count of value \code{i} is in
+//' row \code{i + 1}) and one column per band
+// [[Rcpp::export]]
+arma::mat accum_qa_hist(arma::mat hist, arma::mat& qa, int n_threads=0) {
+    if (hist.n_elem == 0) {
+        hist.zeros(QA_N_BINS, qa.n_cols);
+    } else if (hist.n_rows != QA_N_BINS || hist.n_cols != qa.n_cols) {
+        Rcpp::stop("hist must be a matrix as output by accum_qa_hist");
+    }
+    for (unsigned i = 0; i < qa.n_elem; i++) {
+        double val = qa(i);
+        if (!is_finite(val)) continue;
+        if (val < 0 || val >= QA_N_BINS || val != floor(val)) {
+            Rcpp::stop("QA values must be integers between 0 and 255");
+        }
+    }
+
+    int n_thr = 1;
+#ifdef _OPENMP
+    n_thr = n_threads > 0 ? n_threads : omp_get_max_threads();
+#endif
+    unsigned n_counts = QA_N_BINS * qa.n_cols;
+    std::vector<std::vector<unsigned long> > hists(n_thr,
+            std::vector<unsigned long>(n_counts, 0));
+    #pragma omp parallel num_threads(n_thr)
+    {
+        int thread_num = 0;
+#ifdef _OPENMP
+        thread_num = omp_get_thread_num();
+#endif
+        std::vector<unsigned long>& this_hist = hists[thread_num];
+        #pragma omp for schedule(static)
+        for (int i = 0; i < (int) qa.n_rows; i++) {
+            for (unsigned band = 0; band < qa.n_cols; band++) {
+                double val = qa(i, band);
+                if (is_finite(val)) {
+                    this_hist[band * QA_N_BINS + (unsigned) val]++;
+                }
+            }
+        }
+    }
+    for (int t = 0; t < n_thr; t++) {
+        for (unsigned k = 0; k < n_counts; k++) hist(k) += hists[t][k];
+    }
+    return(hist);
+}
@@ -0,0 +1,24 @@
+#include <RcppArmadillo.h>
+
+using namespace arma;
+
+//' Quantize class probabilities for storage as integers
+//'
+//' Scales class probabilities by \code{scale} and rounds them to the nearest
+//' integer, so that they can be stored using an integer datatype (for example
+//' as INT1U with \code{scale=254}, or INT2S with \code{scale=10000}). Missing
+//' values are kept as NA. This function is called by the
+//' \code{\link{classify}} function. It is not intended to be used directly.
+//'
+//' @param probs class probability matrix (with pixels in rows, classes in
+//' columns)
+//' @param scale the value to scale the probabilities by
+//' @return matrix of quantized probabilities
+// [[Rcpp::export]]
+arma::mat quantize_probs(arma::mat probs, double scale) {
+    double* p = probs.memptr();
+    for (unsigned i = 0; i < probs.n_elem; i++) {
+        if (is_finite(p[i])) p[i] = floor(p[i] * scale + 0.5);
+    }
+    return(probs);
+}
@@ -0,0 +1,130 @@
+#include <RcppArmadillo.h>
+#include <map>
+
+using namespace arma;
+
+// Columns of the per-stratum state matrix used by accum_strata_sample (one
+// row per stratum)
+enum {
+    RES_STRATUM = 0,
+    // Number of pixels in the stratum seen so far
+    RES_N_SEEN,
+    // Algorithm L state: the current weight, and the (0 based) index within
+    // the stratum of the next pixel to be added to the reservoir
+    RES_W,
+    RES_NEXT,
+    RES_NCOLS
+};
+
+// Advance the Algorithm L skip for a full reservoir of size size
+static void next_skip(double& w, double& next, int size) {
+    w *= exp(log(unif_rand()) / size);
+    next += floor(log(unif_rand()) / log(1 - w)) + 1;
+}
+
+//' Accumulate a stratified random sample of pixels
+//'
+//' Updates a reservoir of \code{size} randomly chosen pixels for each stratum
+//' in an image, using one block of pixels. Reservoirs are filled using
+//' Vitter's Algorithm L, which draws random numbers only for the pixels that
+//' are added to a reservoir, so a stratified sample of a whole image is
+//' drawn in a single sequential pass, and every stratum with at least
+//' \code{size} pixels gets exactly \code{size} samples. Random numbers are
+//' drawn from the R random number generator, so results can be reproduced
+//' with \code{set.seed}. This function is called by the
+//' \code{\link{sample_raster}} function, once per block of pixels. It is not
+//' intended to be used directly.
+//'
+//' @param samp the list returned by a previous call to
+//' \code{accum_strata_sample}, or an empty list to start a new sample
+//' @param strata the strata of the pixels in this block, as a vector
+//' @param first_cell the cell number (1 based) of the first pixel in
+//' \code{strata}
+//' @param size the number of pixels to sample from each stratum
+//' @param na_rm whether to skip pixels with missing strata (otherwise missing
+//' values are sampled as a separate stratum)
+//' @return a list with elements \code{state} (a matrix with the stratum, the
+//' number of pixels seen, and the sampler state for each stratum, one row per
+//' stratum) and \code{cells} (a matrix of the sampled cell numbers, with one
+//' row per stratum, and \code{NA} for unfilled places when a stratum has
+//' fewer than \code{size} pixels)
+// [[Rcpp::export]]
+Rcpp::List accum_strata_sample(Rcpp::List samp, arma::vec& strata,
+        double first_cell, int size, bool na_rm=true) {
+    if (size < 1) Rcpp::stop("size must be positive");
+    mat state;
+    mat cells;
+    if (samp.size() == 0) {
+        state.set_size(0, RES_NCOLS);
+        cells.set_size(0, size);
+    } else {
+        state = Rcpp::as<mat>(samp["state"]);
+        cells = Rcpp::as<mat>(samp["cells"]);
+        if (state.n_cols != RES_NCOLS || cells.n_cols != (unsigned) size ||
+                cells.n_rows != state.n_rows) {
+            Rcpp::stop("samp must be a list as output by accum_strata_sample");
+        }
+    }
+
+    // Row of each stratum in the state matrix (missing values are kept
+    // separately, as they cannot be compared)
+    std::map<double, unsigned> rows;
+    int na_row = -1;
+    for (unsigned i = 0; i < state.n_rows; i++) {
+        if (is_finite(state(i, RES_STRATUM))) {
+            rows[state(i, RES_STRATUM)] = i;
+        } else {
+            na_row = i;
+        }
+    }
+
+    for (unsigned i = 0; i < strata.n_elem; i++) {
+        double val = strata(i);
+        bool missing = !is_finite(val);
+        if (missing && na_rm) continue;
+        unsigned row;
+        if (missing && na_row >= 0) {
+            row = na_row;
+        } else if (!missing && rows.count(val)) {
+            row = rows[val];
+        } else {
+            // First pixel of a new stratum
+            row = state.n_rows;
+            state.resize(row + 1, RES_NCOLS);
+            state.row(row).zeros();
+            state(row, RES_STRATUM) = val;
+            cells.resize(row + 1, size);
+            cells.row(row).fill(datum::nan);
+            if (missing) {
+                na_row = row;
+            } else {
+                rows[val] = row;
+            }
+        }
+
+        double cell = first_cell + i;
+        double n_seen = state(row, RES_N_SEEN);
+        if (n_seen < size) {
+            cells(row, (unsigned) n_seen) = cell;
+            if (n_seen + 1 == size) {
+                double w = 1, next = n_seen;
+                next_skip(w, next, size);
+                state(row, RES_W) = w;
+                state(row, RES_NEXT) = next;
+            }
+        } else if (n_seen == state(row, RES_NEXT)) {
+            // Replace a random member of the reservoir
+            unsigned slot = std::min<unsigned>(size - 1,
+                                               floor(unif_rand() * size));
+            cells(row, slot) = cell;
+            double w = state(row, RES_W), next = n_seen;
+            next_skip(w, next, size);
+            state(row, RES_W) = w;
+            state(row, RES_NEXT) = next;
+        }
+        state(row, RES_N_SEEN) = n_seen + 1;
+    }
+
+    return(Rcpp::List::create(Rcpp::Named("state")=state,
+                              Rcpp::Named("cells")=cells));
+}
@@ -0,0 +1,126 @@
+#include <RcppArmadillo.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace arma;
+
+// Number of pixels processed together - all trees are run over one batch of
+// pixels before moving to the next batch, so that each tree stays in cache
+// while it is used.
+const unsigned RF_BATCH_SIZE = 256;
+
+struct rf_node {
+    // Index of the split variable (0 based), or -1 for terminal nodes
+    int var;
+    // Index of the left daughter (or, for terminal nodes, the predicted
+    // class, 0 based)
+    int left;
+    int right;
+    double split;
+};
+
+//' Predict class probabilities from a flattened random forest
+//'
+//' Runs all trees of a random forest (as flattened by \code{flatten_rf}) over
+//' a matrix of pixels, and returns the fraction of trees voting for each
+//' class, matching \code{predict(model, type="prob")} for a
+//' \code{randomForest} classifier. Pixels are processed in batches, in
+//' parallel when OpenMP is available. This function is called by the
+//' \code{\link{classify}} function. It is not intended to be used directly.
+//'
+//' @param x the predictors as a matrix, with pixels in rows and bands in
+//' columns
+//' @param forest a flattened random forest as output by \code{flatten_rf}
+//' @param n_threads number of threads to use (if 0, use the OpenMP default)
+//' @return matrix of class probabilities with pixels in rows and classes in
+//' columns. Pixels with missing values in any predictor are coded as NA.
+// [[Rcpp::export]]
+arma::mat rf_predict_prob(arma::mat& x, Rcpp::List forest, int n_threads=0) {
+    ivec var_band = Rcpp::as<ivec>(forest["var_band"]);
+    vec var_level = Rcpp::as<vec>(forest["var_level"]);
+    ivec var_ncat = Rcpp::as<ivec>(forest["var_ncat"]);
+    ivec tree_start = Rcpp::as<ivec>(forest["tree_start"]);
+    ivec node_var = Rcpp::as<ivec>(forest["node_var"]);
+    ivec node_left = Rcpp::as<ivec>(forest["node_left"]);
+    ivec node_right = Rcpp::as<ivec>(forest["node_right"]);
+    vec node_split = Rcpp::as<vec>(forest["node_split"]);
+    int n_class = Rcpp::as<int>(forest["n_class"]);
+
+    unsigned n_var = var_band.n_elem;
+    unsigned n_tree = tree_start.n_elem;
+    for (unsigned j = 0; j < n_var; j++) {
+        if (var_band(j) < 0 || var_band(j) >= (int) x.n_cols) {
+            Rcpp::stop("forest references a band that is not in x");
+        }
+    }
+
+    // Pack the nodes into one contiguous array
+    std::vector<rf_node> nodes(node_var.n_elem);
+    for (unsigned i = 0; i < node_var.n_elem; i++) {
+        nodes[i].var = node_var(i);
+        nodes[i].left = node_left(i);
+        nodes[i].right = node_right(i);
+        nodes[i].split = node_split(i);
+    }
+
+    mat probs(x.n_rows, n_class);
+    unsigned n_batches = (x.n_rows + RF_BATCH_SIZE - 1) / RF_BATCH_SIZE;
+
+    int n_thr = 1;
+#ifdef _OPENMP
+    n_thr = n_threads > 0 ? n_threads : omp_get_max_threads();
+#endif
+    #pragma omp parallel for schedule(dynamic) num_threads(n_thr)
+    for (unsigned batch = 0; batch < n_batches; batch++) {
+        unsigned first = batch * RF_BATCH_SIZE;
+        unsigned n = std::min<unsigned>(RF_BATCH_SIZE, x.n_rows - first);
+        // Build the predictor values for this batch (pixels in columns, so
+        // each pixel's predictors are contiguous), converting factor bands to
+        // the dummy variables used when the model was fit
+        mat feat(n_var, n);
+        std::vector<bool> valid(n, true);
+        for (unsigned p = 0; p < n; p++) {
+            for (unsigned j = 0; j < n_var; j++) {
+                double val = x(first + p, var_band(j));
+                if (!is_finite(val)) {
+                    valid[p] = false;
+                    break;
+                }
+                if (is_finite(var_level(j))) val = (val == var_level(j));
+                feat(j, p) = val;
+            }
+        }
+        umat votes(n, n_class, fill::zeros);
+        for (unsigned t = 0; t < n_tree; t++) {
+            const rf_node* tree = &nodes[tree_start(t)];
+            for (unsigned p = 0; p < n; p++) {
+                if (!valid[p]) continue;
+                const double* px = feat.colptr(p);
+                int k = 0;
+                while (tree[k].var >= 0) {
+                    const rf_node& node = tree[k];
+                    bool go_left;
+                    if (var_ncat(node.var) <= 1) {
+                        go_left = px[node.var] <= node.split;
+                    } else {
+                        // Categorical split - the split value is a bitmask of
+                        // the categories (1 based) that go left
+                        unsigned long cats = (unsigned long) node.split;
+                        go_left = (cats >> ((int) px[node.var] - 1)) & 1UL;
+                    }
+                    k = go_left ? node.left : node.right;
+                }
+                votes(p, tree[k].left)++;
+            }
+        }
+        for (unsigned p = 0; p < n; p++) {
+            for (int c = 0; c < n_class; c++) {
+                probs(first + p, c) = valid[p] ?
+                    double(votes(p, c)) / n_tree : datum::nan;
+            }
+        }
+    }
+
+    return(probs);
+}
@@ -0,0 +1,149 @@
+#include <RcppArmadillo.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include <algorithm>
+
+using namespace arma;
+
+// Find the cells (0 based, row-major) with centers inside one polygon, using
+// a scanline fill with the even-odd rule over all of the polygon's rings (so
+// holes are excluded). Cells are returned in increasing order.
+static void fill_polygon(const std::vector<unsigned>& rings,
+        const vec& vx, const vec& vy, const uvec& ring_start,
+        double xmin, double ymax, double res_x, double res_y,
+        int nrows, int ncols, std::vector<double>& cells) {
+    double poly_ymin = datum::inf, poly_ymax = -datum::inf;
+    for (unsigned k = 0; k < rings.size(); k++) {
+        for (unsigned v = ring_start(rings[k]); v < ring_start(rings[k] + 1); v++) {
+            if (vy(v) < poly_ymin) poly_ymin = vy(v);
+            if (vy(v) > poly_ymax) poly_ymax = vy(v);
+        }
+    }
+    // Rows with centers that could fall within the polygon
+    int first_row = std::max(0, (int) ceil((ymax - poly_ymax) / res_y - 0.5));
+    int last_row = std::min(nrows - 1,
+                            (int) floor((ymax - poly_ymin) / res_y - 0.5));
+    std::vector<double> xs;
+    for (int row = first_row; row <= last_row; row++) {
+        double y = ymax - (row + 0.5) * res_y;
+        xs.clear();
+        for (unsigned k = 0; k < rings.size(); k++) {
+            unsigned start = ring_start(rings[k]);
+            unsigned end = ring_start(rings[k] + 1);
+            for (unsigned v = start; v < end; v++) {
+                // Edge from vertex v to the next vertex (closing the ring)
+                unsigned w = (v + 1 < end) ? v + 1 : start;
+                double y1 = vy(v), y2 = vy(w);
+                // Half-open rule so vertices on the scanline are counted once
+                if ((y1 <= y && y < y2) || (y2 <= y && y < y1)) {
+                    xs.push_back(vx(v) + (y - y1) * (vx(w) - vx(v)) / (y2 - y1));
+                }
+            }
+        }
+        std::sort(xs.begin(), xs.end());
+        for (unsigned k = 0; k + 1 < xs.size(); k += 2) {
+            // Columns with centers in [xs[k], xs[k + 1])
+            int first_col = std::max(0, (int) ceil((xs[k] - xmin) / res_x - 0.5));
+            int last_col = std::min(ncols - 1,
+                                    (int) ceil((xs[k + 1] - xmin) / res_x - 0.5) - 1);
+            for (int col = first_col; col <= last_col; col++) {
+                cells.push_back((double) row * ncols + col);
+            }
+        }
+    }
+    // Spans on a row are disjoint (with the even-odd rule, overlapping parts
+    // of a multipart polygon cancel rather than repeat), and rows are filled
+    // in order, so cells are already unique and sorted.
+}
+
+//' Find the raster cells covered by a set of polygons
+//'
+//' Rasterizes a set of polygons at the grid of a raster using a scanline
+//' fill, returning the cells whose centers fall within each polygon. If
+//' \code{small} is \code{TRUE}, polygons that do not contain the center of any
+//' cell are assigned the cells containing their vertices instead. Polygons
+//' are processed in parallel when OpenMP is available. This function is called
+//' by the \code{\link{get_pixels}} function. It is not intended to be used
+//' directly.
+//'
+//' @param vx x coordinates of the vertices of all rings of all polygons
+//' @param vy y coordinates of the vertices of all rings of all polygons
+//' @param ring_start index (0 based) of the first vertex of each ring in
+//' \code{vx} and \code{vy}, followed by the total number of vertices
+//' @param ring_poly index (0 based) of the polygon each ring belongs to
+//' @param n_poly number of polygons
+//' @param xmin minimum x coordinate of the raster
+//' @param ymax maximum y coordinate of the raster
+//' @param res_x x resolution of the raster
+//' @param res_y y resolution of the raster
+//' @param nrows number of rows in the raster
+//' @param ncols number of columns in the raster
+//' @param small whether to return the cells containing the vertices of
+//' polygons that do not contain the center of any cell
+//' @param n_threads number of threads to use (if 0, use the OpenMP default)
+//' @return list with elements "cell" (the 1 based cell numbers) and "poly"
+//' (the 1 based polygon index of each cell), ordered by polygon and then by
+//' cell
+// [[Rcpp::export]]
+Rcpp::List scanline_cells(arma::vec& vx, arma::vec& vy, arma::uvec& ring_start,
+        arma::uvec& ring_poly, int n_poly, double xmin, double ymax,
+        double res_x, double res_y, int nrows, int ncols, bool small=true,
+        int n_threads=0) {
+    if (vx.n_elem != vy.n_elem) {
+        Rcpp::stop("vx and vy must be the same length");
+    }
+    if (ring_start.n_elem != ring_poly.n_elem + 1 ||
+            ring_start(ring_poly.n_elem) != vx.n_elem) {
+        Rcpp::stop("ring_start must have one element per ring, followed by the number of vertices");
+    }
+    std::vector<std::vector<unsigned> > poly_rings(n_poly);
+    for (unsigned k = 0; k < ring_poly.n_elem; k++) {
+        if (ring_poly(k) >= (unsigned) n_poly) {
+            Rcpp::stop("ring_poly references a polygon index larger than n_poly");
+        }
+        poly_rings[ring_poly(k)].push_back(k);
+    }
+
+    std::vector<std::vector<double> > poly_cells(n_poly);
+    int n_thr = 1;
+#ifdef _OPENMP
+    n_thr = n_threads > 0 ? n_threads : omp_get_max_threads();
+#endif
+    #pragma omp parallel for schedule(dynamic) num_threads(n_thr)
+    for (int p = 0; p < n_poly; p++) {
+        std::vector<double>& cells = poly_cells[p];
+        fill_polygon(poly_rings[p], vx, vy, ring_start, xmin, ymax, res_x,
+                     res_y, nrows, ncols, cells);
+        if (cells.size() == 0 && small) {
+            for (unsigned k = 0; k < poly_rings[p].size(); k++) {
+                unsigned r = poly_rings[p][k];
+                for (unsigned v = ring_start(r); v < ring_start(r + 1); v++) {
+                    double col = floor((vx(v) - xmin) / res_x);
+                    double row = floor((ymax - vy(v)) / res_y);
+                    if (col < 0 || col >= ncols || row < 0 || row >= nrows) {
+                        continue;
+                    }
+                    cells.push_back(row * ncols + col);
+                }
+            }
+            std::sort(cells.begin(), cells.end());
+            cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+        }
+    }
+
+    unsigned n_cells = 0;
+    for (int p = 0; p < n_poly; p++) n_cells += poly_cells[p].size();
+    Rcpp::NumericVector cell_out(n_cells);
+    Rcpp::IntegerVector poly_out(n_cells);
+    unsigned i = 0;
+    for (int p = 0; p < n_poly; p++) {
+        for (unsigned k = 0; k < poly_cells[p].size(); k++) {
+            cell_out(i) = poly_cells[p][k] + 1;
+            poly_out(i) = p + 1;
+            i++;
+        }
+    }
+    return(Rcpp::List::create(Rcpp::Named("cell")=cell_out,
+                              Rcpp::Named("poly")=poly_out));
+}
@@ -0,0 +1,321 @@
+#include <RcppArmadillo.h>
+#include <algorithm>
+#include <utility>
+
+using namespace arma;
+
+// Minimum number of edges held before the edge list is compacted
+const size_t SIEVE_MIN_COMPACT = 65536;
+
+// State of a sieve filter, carried between blocks. The image is labeled one
+// block of rows at a time: each pixel is given the provisional label of the
+// first neighbor (in the row above, or to its left) that has the same value,
+// or a new label if there is no such neighbor. Provisional labels belonging
+// to the same region are joined with a union-find forest, so only the labels
+// and values of the last row of the previous block need to be kept. The same
+// labeling is repeated in the second pass, where each provisional label is
+// mapped to its final (sieved) value.
+struct sieve_state {
+    int n_cols;
+    bool diagonal;
+    bool resolved;
+    // Labels and values of the last row processed (-1 for missing pixels)
+    std::vector<int> prev_labels;
+    std::vector<double> prev_vals;
+    // Number of provisional labels assigned so far (in the current pass)
+    int n_labels;
+    // Union-find parent, pixel count, and value of each provisional label
+    std::vector<int> parent;
+    std::vector<int> count;
+    std::vector<double> value;
+    // Pairs of provisional labels of neighboring pixels with different
+    // values, and the size of the list when it was last compacted
+    std::vector<std::pair<int, int> > edges;
+    size_t n_compacted;
+    // Sieved value of each provisional label (set by sieve_resolve)
+    std::vector<double> final_value;
+};
+
+static int find_root(std::vector<int>& parent, int i) {
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return(i);
+}
+
+static void join(std::vector<int>& parent, int a, int b) {
+    a = find_root(parent, a);
+    b = find_root(parent, b);
+    if (a < b) {
+        parent[b] = a;
+    } else if (b < a) {
+        parent[a] = b;
+    }
+}
+
+// Replace the labels in the edge list with their roots, and remove
+// duplicate edges
+static void compact_edges(sieve_state& s) {
+    size_t n = 0;
+    for (size_t i = 0; i < s.edges.size(); i++) {
+        int a = find_root(s.parent, s.edges[i].first);
+        int b = find_root(s.parent, s.edges[i].second);
+        if (a == b) continue;
+        s.edges[n++] = std::make_pair(std::min(a, b), std::max(a, b));
+    }
+    s.edges.resize(n);
+    std::sort(s.edges.begin(), s.edges.end());
+    s.edges.erase(std::unique(s.edges.begin(), s.edges.end()), s.edges.end());
+    s.n_compacted = s.edges.size();
+}
+
+static sieve_state* get_state(SEXP state) {
+    Rcpp::XPtr<sieve_state> ptr(state);
+    if (ptr.get() == NULL) Rcpp::stop("invalid sieve state");
+    return(ptr.get());
+}
+
+// Label one block of rows, carrying on from the previous block. In the
+// first pass, regions are joined and their areas and neighbors are recorded.
+// In the second pass, the sieved value of each pixel is stored in out.
+static void label_block(sieve_state& s, const double* vals, int n_rows,
+        double* out) {
+    int n_cols = s.n_cols;
+    std::vector<int> cur_labels(n_cols);
+    // Offsets (in columns) of the neighbors in the row above
+    int up_offsets[] = {-1, 0, 1};
+    int up_first = s.diagonal ? 0 : 1;
+    int up_last = s.diagonal ? 2 : 1;
+    for (int row = 0; row < n_rows; row++) {
+        const double* row_vals = vals + (size_t) row * n_cols;
+        for (int col = 0; col < n_cols; col++) {
+            double val = row_vals[col];
+            if (!is_finite(val)) {
+                cur_labels[col] = -1;
+                if (out) out[(size_t) row * n_cols + col] = val;
+                continue;
+            }
+            int label = -1;
+            // Left neighbor, then neighbors in the row above
+            for (int k = up_first - 1; k <= up_last; k++) {
+                int nb_col, nb_label;
+                double nb_val;
+                if (k < up_first) {
+                    nb_col = col - 1;
+                    if (nb_col < 0) continue;
+                    nb_label = cur_labels[nb_col];
+                    nb_val = row_vals[nb_col];
+                } else {
+                    nb_col = col + up_offsets[k];
+                    if (nb_col < 0 || nb_col >= n_cols) continue;
+                    nb_label = s.prev_labels[nb_col];
+                    nb_val = s.prev_vals[nb_col];
+                }
+                if (nb_label < 0) continue;
+                if (nb_val == val) {
+                    if (label < 0) {
+                        label = nb_label;
+                    } else if (!s.resolved && nb_label != label) {
+                        join(s.parent, label, nb_label);
+                    }
+                } else if (!s.resolved) {
+                    s.edges.push_back(std::make_pair(nb_label, -1));
+                }
+            }
+            if (label < 0) {
+                label = s.n_labels++;
+                if (!s.resolved) {
+                    s.parent.push_back(label);
+                    s.count.push_back(0);
+                    s.value.push_back(val);
+                }
+            }
+            if (s.resolved) {
+                out[(size_t) row * n_cols + col] = s.final_value[label];
+            } else {
+                s.count[label]++;
+                // Fill in this pixel's label on the edges just recorded
+                for (size_t i = s.edges.size(); i > 0 &&
+                        s.edges[i - 1].second == -1; i--) {
+                    s.edges[i - 1].second = label;
+                }
+            }
+            cur_labels[col] = label;
+        }
+        s.prev_labels.swap(cur_labels);
+        s.prev_vals.assign(row_vals, row_vals + n_cols);
+    }
+    if (!s.resolved &&
+            s.edges.size() > 2 * s.n_compacted + SIEVE_MIN_COMPACT) {
+        compact_edges(s);
+    }
+}
+
+//' Start a sieve filter
+//'
+//' Creates the state used by \code{sieve_label_block},
+//' \code{sieve_resolve}, and \code{sieve_apply_block} to sieve an image one
+//' block of rows at a time. This function is called by the
+//' \code{\link{sieve}} function. It is not intended to be used directly.
+//'
+//' @param n_cols number of columns in the image
+//' @param directions the connectivity used to define regions: 4 (rook's
+//' case) or 8 (queen's case)
+//' @return an external pointer to the sieve state
+// [[Rcpp::export]]
+SEXP sieve_init(int n_cols, int directions=8) {
+    if (n_cols < 1) Rcpp::stop("n_cols must be positive");
+    if (directions != 4 && directions != 8) {
+        Rcpp::stop("directions must be 4 or 8");
+    }
+    sieve_state* s = new sieve_state;
+    s->n_cols = n_cols;
+    s->diagonal = directions == 8;
+    s->resolved = false;
+    s->prev_labels.assign(n_cols, -1);
+    s->prev_vals.assign(n_cols, datum::nan);
+    s->n_labels = 0;
+    s->n_compacted = 0;
+    return(Rcpp::XPtr<sieve_state>(s, true));
+}
+
+//' Label the regions in one block of an image for a sieve filter
+//'
+//' Labels the connected regions of equal value in a block of rows, joining
+//' them to the regions labeled in previous blocks, and records the area and
+//' neighbors of each region. Blocks must be passed in order from the top of
+//' the image. This function is called by the \code{\link{sieve}} function. It
+//' is not intended to be used directly.
+//'
+//' @param state the sieve state, as returned by \code{sieve_init}
+//' @param x a block of the image as a vector, in row-major order (as
+//' returned by \code{getValues})
+//' @return nothing (the state is updated in place)
+// [[Rcpp::export]]
+void sieve_label_block(SEXP state, Rcpp::NumericVector x) {
+    sieve_state* s = get_state(state);
+    if (s->resolved) Rcpp::stop("sieve has already been resolved");
+    if (x.size() % s->n_cols != 0) {
+        Rcpp::stop("length of x must be a multiple of the number of columns");
+    }
+    label_block(*s, x.begin(), x.size() / s->n_cols, NULL);
+}
+
+//' Merge small regions for a sieve filter
+//'
+//' Merges each region with fewer than \code{min_pixels} pixels into its
+//' largest neighboring region, once all blocks of an image have been labeled
+//' with \code{sieve_label_block}. Regions are merged in order of increasing
+//' size, and merging is repeated until no region smaller than
+//' \code{min_pixels} has a neighbor (regions surrounded by missing values are
+//' left unchanged). This function is called by the \code{\link{sieve}}
+//' function. It is not intended to be used directly.
+//'
+//' @param state the sieve state, as returned by \code{sieve_init}
+//' @param min_pixels the minimum size (in pixels) of a region
+//' @return a list with the number of regions in the image
+//' (\code{n_regions}), and the number of those that were merged into a
+//' neighbor (\code{n_merged})
+// [[Rcpp::export]]
+Rcpp::List sieve_resolve(SEXP state, double min_pixels) {
+    sieve_state* s = get_state(state);
+    if (s->resolved) Rcpp::stop("sieve has already been resolved");
+    compact_edges(*s);
+    int n = s->n_labels;
+
+    // Area of each region (stored at its root)
+    std::vector<double> area(n, 0);
+    for (int i = 0; i < n; i++) {
+        area[find_root(s->parent, i)] += s->count[i];
+    }
+    std::vector<int>().swap(s->count);
+    std::vector<std::vector<int> > neighbors(n);
+    for (size_t i = 0; i < s->edges.size(); i++) {
+        neighbors[s->edges[i].first].push_back(s->edges[i].second);
+        neighbors[s->edges[i].second].push_back(s->edges[i].first);
+    }
+    std::vector<std::pair<int, int> >().swap(s->edges);
+
+    std::vector<std::pair<double, int> > small;
+    int n_regions = 0;
+    for (int i = 0; i < n; i++) {
+        if (s->parent[i] != i) continue;
+        n_regions++;
+        if (area[i] < min_pixels) small.push_back(std::make_pair(area[i], i));
+    }
+    std::sort(small.begin(), small.end());
+
+    // Merge each small region into its largest neighbor. A small region that
+    // is merged into another small region passes on its neighbors, so that
+    // the combined region can be merged again if it is still too small.
+    int n_merged = 0;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t k = 0; k < small.size(); k++) {
+            int r = small[k].second;
+            if (s->parent[r] != r || area[r] >= min_pixels) continue;
+            int best = -1;
+            for (size_t i = 0; i < neighbors[r].size(); i++) {
+                int nb = find_root(s->parent, neighbors[r][i]);
+                if (nb == r) continue;
+                if (best < 0 || area[nb] > area[best] ||
+                        (area[nb] == area[best] && nb < best)) {
+                    best = nb;
+                }
+            }
+            if (best < 0) continue;
+            s->parent[r] = best;
+            area[best] += area[r];
+            if (area[best] < min_pixels) {
+                neighbors[best].insert(neighbors[best].end(),
+                                       neighbors[r].begin(),
+                                       neighbors[r].end());
+            }
+            std::vector<int>().swap(neighbors[r]);
+            n_merged++;
+            changed = true;
+        }
+    }
+
+    s->final_value.resize(n);
+    for (int i = 0; i < n; i++) {
+        s->final_value[i] = s->value[find_root(s->parent, i)];
+    }
+    std::vector<int>().swap(s->parent);
+    std::vector<double>().swap(s->value);
+
+    // Reset the labeling for the second pass
+    s->resolved = true;
+    s->n_labels = 0;
+    s->prev_labels.assign(s->n_cols, -1);
+    s->prev_vals.assign(s->n_cols, datum::nan);
+
+    return(Rcpp::List::create(Rcpp::Named("n_regions")=n_regions,
+                              Rcpp::Named("n_merged")=n_merged));
+}
+
+//' Apply a sieve filter to one block of an image
+//'
+//' Repeats the labeling done by \code{sieve_label_block}, and returns the
+//' sieved values of a block of rows. Blocks must be the same as those passed
+//' to \code{sieve_label_block}, in the same order. This function is called by
+//' the \code{\link{sieve}} function. It is not intended to be used directly.
+//'
+//' @param state the sieve state, as returned by \code{sieve_init}, after
+//' \code{sieve_resolve} has been called
+//' @param x a block of the image as a vector, in row-major order (as
+//' returned by \code{getValues})
+//' @return the sieved block as a vector, in row-major order
+// [[Rcpp::export]]
+Rcpp::NumericVector sieve_apply_block(SEXP state, Rcpp::NumericVector x) {
+    sieve_state* s = get_state(state);
+    if (!s->resolved) Rcpp::stop("sieve must be resolved before it is applied");
+    if (x.size() % s->n_cols != 0) {
+        Rcpp::stop("length of x must be a multiple of the number of columns");
+    }
+    Rcpp::NumericVector out(x.size());
+    label_block(*s, x.begin(), x.size() / s->n_cols, out.begin());
+    return(out);
+}
@@ -0,0 +1,195 @@
+#include <RcppArmadillo.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace arma;
+
+// Number of pixels processed together - the kernel values for a batch of
+// pixels are calculated as a (pixels x support vectors) matrix product
+const unsigned SVM_BATCH_SIZE = 512;
+
+// Solve the (small, dense) linear system A x = b in place using Gaussian
+// elimination with partial pivoting. A is n x n, stored column-major.
+static void solve_small(std::vector<double>& A, std::vector<double>& b,
+        int n) {
+    for (int k = 0; k < n; k++) {
+        int piv = k;
+        for (int i = k + 1; i < n; i++) {
+            if (fabs(A[i + k * n]) > fabs(A[piv + k * n])) piv = i;
+        }
+        if (piv != k) {
+            for (int j = 0; j < n; j++) std::swap(A[k + j * n], A[piv + j * n]);
+            std::swap(b[k], b[piv]);
+        }
+        for (int i = k + 1; i < n; i++) {
+            double f = A[i + k * n] / A[k + k * n];
+            if (f == 0) continue;
+            for (int j = k; j < n; j++) A[i + j * n] -= f * A[k + j * n];
+            b[i] -= f * b[k];
+        }
+    }
+    for (int k = n - 1; k >= 0; k--) {
+        for (int j = k + 1; j < n; j++) b[k] -= A[k + j * n] * b[j];
+        b[k] /= A[k + k * n];
+    }
+}
+
+//' Predict class probabilities from a flattened radial basis function SVM
+//'
+//' Evaluates a radial basis function support vector machine (as flattened by
+//' \code{flatten_svm}) over a matrix of pixels. The squared distances between
+//' each batch of pixels and the support vectors are calculated as a blocked
+//' matrix product, the decision values of all the one against one classifiers
+//' are calculated from the resulting kernel matrix, and the Platt-scaled
+//' binary probabilities are coupled into class probabilities using the same
+//' method as \code{kernlab}. Batches are processed in parallel when OpenMP is
+//' available. This function is called by the \code{\link{classify}} function.
+//' It is not intended to be used directly.
+//'
+//' @param x the predictors as a matrix, with pixels in rows and bands in
+//' columns
+//' @param svm a flattened SVM as output by \code{flatten_svm}
+//' @param n_threads number of threads to use (if 0, use the OpenMP default)
+//' @return matrix of class probabilities with pixels in rows and classes in
+//' columns. Pixels with missing values in any predictor are coded as NA.
+//' @references Platt, J. C. 2000. Probabilistic outputs for support vector
+//' machines and comparisons to regularized likelihood methods. Pages 61--74 in
+//' Advances in Large Margin Classifiers. MIT Press, Cambridge, MA.
+//'
+//' Wu, T.-F., C.-J. Lin, and R. C. Weng. 2004. Probability estimates for
+//' multi-class classification by pairwise coupling. Journal of Machine
+//' Learning Research 5:975--1005.
+// [[Rcpp::export]]
+arma::mat svm_predict_prob(arma::mat& x, Rcpp::List svm, int n_threads=0) {
+    ivec var_band = Rcpp::as<ivec>(svm["var_band"]);
+    vec var_level = Rcpp::as<vec>(svm["var_level"]);
+    vec center = Rcpp::as<vec>(svm["center"]);
+    vec scale = Rcpp::as<vec>(svm["scale"]);
+    double sigma = Rcpp::as<double>(svm["sigma"]);
+    mat sv = Rcpp::as<mat>(svm["sv"]);
+    mat sv_coef = Rcpp::as<mat>(svm["sv_coef"]);
+    rowvec b = Rcpp::as<rowvec>(svm["b"]);
+    vec prob_A = Rcpp::as<vec>(svm["prob_A"]);
+    vec prob_B = Rcpp::as<vec>(svm["prob_B"]);
+    uvec upper_row = Rcpp::as<uvec>(svm["upper_row"]);
+    uvec upper_col = Rcpp::as<uvec>(svm["upper_col"]);
+    uvec lower_row = Rcpp::as<uvec>(svm["lower_row"]);
+    uvec lower_col = Rcpp::as<uvec>(svm["lower_col"]);
+    int n_class = Rcpp::as<int>(svm["n_class"]);
+
+    unsigned n_var = var_band.n_elem;
+    unsigned n_pairs = sv_coef.n_cols;
+    if (sv.n_cols != n_var) {
+        Rcpp::stop("number of support vector columns does not match number of predictors");
+    }
+    if (n_pairs != (unsigned) (n_class * (n_class - 1) / 2) ||
+            b.n_elem != n_pairs || upper_row.n_elem != n_pairs) {
+        Rcpp::stop("svm must have one binary classifier per pair of classes");
+    }
+    for (unsigned j = 0; j < n_var; j++) {
+        if (var_band(j) < 0 || var_band(j) >= (int) x.n_cols) {
+            Rcpp::stop("svm references a band that is not in x");
+        }
+    }
+
+    // Squared norms of the support vectors (reused for every batch)
+    rowvec sv_norm = sum(square(sv), 1).t();
+
+    mat probs(x.n_rows, n_class);
+    unsigned n_batches = (x.n_rows + SVM_BATCH_SIZE - 1) / SVM_BATCH_SIZE;
+
+    int n_thr = 1;
+#ifdef _OPENMP
+    n_thr = n_threads > 0 ? n_threads : omp_get_max_threads();
+#endif
+    #pragma omp parallel for schedule(dynamic) num_threads(n_thr)
+    for (unsigned batch = 0; batch < n_batches; batch++) {
+        unsigned first = batch * SVM_BATCH_SIZE;
+        unsigned n = std::min<unsigned>(SVM_BATCH_SIZE, x.n_rows - first);
+
+        // Center and scale the predictors, converting factor bands to the
+        // dummy variables used when the model was fit
+        mat feat(n, n_var);
+        std::vector<bool> valid(n, true);
+        for (unsigned j = 0; j < n_var; j++) {
+            for (unsigned p = 0; p < n; p++) {
+                double val = x(first + p, var_band(j));
+                if (!is_finite(val)) {
+                    valid[p] = false;
+                    val = 0;
+                } else if (is_finite(var_level(j))) {
+                    val = (val == var_level(j));
+                }
+                feat(p, j) = (val - center(j)) / scale(j);
+            }
+        }
+
+        // exp(-sigma * ||x - sv||^2), with ||x - sv||^2 expanded as
+        // ||x||^2 + ||sv||^2 - 2 x . sv so that the cross terms are one matrix
+        // product
+        mat kern = feat * sv.t();
+        vec feat_norm = sum(square(feat), 1);
+        kern *= -2;
+        kern.each_col() += feat_norm;
+        kern.each_row() += sv_norm;
+        // Round off error can give (tiny) negative squared distances
+        double* kern_ptr = kern.memptr();
+        for (unsigned i = 0; i < kern.n_elem; i++) {
+            if (kern_ptr[i] < 0) kern_ptr[i] = 0;
+        }
+        kern = exp(-sigma * kern);
+        mat dec = kern * sv_coef;
+        dec.each_row() -= b;
+
+        std::vector<double> Q((n_class + 1) * (n_class + 1));
+        std::vector<double> rhs(n_class + 1);
+        mat pairwise(n_class, n_class);
+        for (unsigned p = 0; p < n; p++) {
+            if (!valid[p]) {
+                for (int c = 0; c < n_class; c++) {
+                    probs(first + p, c) = datum::nan;
+                }
+                continue;
+            }
+            // Platt scaling of the decision values to binary probabilities
+            pairwise.zeros();
+            for (unsigned k = 0; k < n_pairs; k++) {
+                double fApB = dec(p, k) * prob_A(k) + prob_B(k);
+                double sig;
+                if (fApB >= 0) {
+                    sig = exp(-fApB) / (1 + exp(-fApB));
+                } else {
+                    sig = 1 / (1 + exp(fApB));
+                }
+                double bin_prob = 1 - sig;
+                pairwise(upper_row(k), upper_col(k)) = bin_prob;
+                pairwise(lower_row(k), lower_col(k)) = 1 - bin_prob;
+            }
+            // Pairwise coupling (kernlab "minpair" method): solve the linear
+            // system for the class probabilities, constrained to sum to one
+            int m = n_class + 1;
+            std::fill(Q.begin(), Q.end(), 0);
+            std::fill(rhs.begin(), rhs.end(), 0);
+            for (int c = 0; c < n_class; c++) {
+                Q[c + c * m] = accu(square(pairwise.col(c)));
+                Q[n_class + c * m] = 1;
+                Q[c + n_class * m] = 1;
+            }
+            for (unsigned k = 0; k < n_pairs; k++) {
+                double up = pairwise(upper_row(k), upper_col(k));
+                Q[upper_row(k) + upper_col(k) * m] = -up * (1 - up);
+                Q[lower_row(k) + lower_col(k) * m] = -up * (1 - up);
+            }
+            rhs[n_class] = 1;
+            solve_small(Q, rhs, m);
+            double total = 0;
+            for (int c = 0; c < n_class; c++) total += rhs[c];
+            for (int c = 0; c < n_class; c++) {
+                probs(first + p, c) = rhs[c] / total;
+            }
+        }
+    }
+
+    return(probs);
+}
@@ -0,0 +1,372 @@
+#include <RcppArmadillo.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include <cstring>
+#include "mapped_file.h"
+
+using namespace arma;
+
+// TIMESAT binary files start with a header of 6 32-bit integers: nyears,
+// nptperyear, rowstart, rowstop, colstart, colstop
+const unsigned TS_HEADER_INTS = 6;
+const size_t TS_HEADER_SIZE = TS_HEADER_INTS * sizeof(int);
+
+// Number of elements in the .tts record header (row, column)
+const unsigned TTS_RECORD_HEADER_INTS = 2;
+
+struct timesat_header {
+    int n_years;
+    int n_pts_per_year;
+    int row_start;
+    int row_stop;
+    int col_start;
+    int col_stop;
+};
+
+static timesat_header read_timesat_header(const mapped_file& f) {
+    if (f.size() < TS_HEADER_SIZE) {
+        Rcpp::stop("file is too short to contain a TIMESAT header");
+    }
+    int vals[TS_HEADER_INTS];
+    memcpy(vals, f.data(), TS_HEADER_SIZE);
+    timesat_header hdr;
+    hdr.n_years = vals[0];
+    hdr.n_pts_per_year = vals[1];
+    hdr.row_start = vals[2];
+    hdr.row_stop = vals[3];
+    hdr.col_start = vals[4];
+    hdr.col_stop = vals[5];
+    if (hdr.n_years < 1 || hdr.n_pts_per_year < 1 ||
+            hdr.row_stop < hdr.row_start || hdr.col_stop < hdr.col_start) {
+        Rcpp::stop("invalid TIMESAT file header");
+    }
+    return(hdr);
+}
+
+// Size in bytes of one fixed-length .tts pixel record
+static size_t tts_record_size(const timesat_header& hdr) {
+    return(sizeof(int) * TTS_RECORD_HEADER_INTS +
+           sizeof(float) * hdr.n_years * hdr.n_pts_per_year);
+}
+
+// Number of pixel records in a .tts file, checking that the file holds a
+// whole number of records
+static size_t tts_record_count(const mapped_file& f,
+        const timesat_header& hdr) {
+    size_t record_size = tts_record_size(hdr);
+    if ((f.size() - TS_HEADER_SIZE) % record_size != 0) {
+        Rcpp::stop("tts file size does not match the record size given by the header");
+    }
+    return((f.size() - TS_HEADER_SIZE) / record_size);
+}
+
+//' Read a TIMESAT .tts file
+//'
+//' Memory-maps a TIMESAT .tts (fitted time series) file, validates the file
+//' header, and decodes the fixed length pixel records into a matrix, in
+//' parallel when OpenMP is available. This function is called by the
+//' \code{\link{tts2df}} function. It is not intended to be used directly.
+//'
+//' @param filename the .tts file to read
+//' @param n_threads number of threads to use (if 0, use the OpenMP default)
+//' @return matrix with one row per pixel, giving the row and column of the
+//' pixel followed by the fitted value at each time point
+// [[Rcpp::export]]
+arma::mat read_tts(std::string filename, int n_threads=0) {
+    mapped_file f(filename);
+    timesat_header hdr = read_timesat_header(f);
+    size_t n_records = tts_record_count(f, hdr);
+    size_t record_size = tts_record_size(hdr);
+    unsigned n_pts = hdr.n_years * hdr.n_pts_per_year;
+
+    mat tts(n_records, TTS_RECORD_HEADER_INTS + n_pts);
+    const char* records = f.data() + TS_HEADER_SIZE;
+
+    int n_thr = 1;
+#ifdef _OPENMP
+    n_thr = n_threads > 0 ? n_threads : omp_get_max_threads();
+#endif
+    #pragma omp parallel num_threads(n_thr)
+    {
+        std::vector<float> vals(n_pts);
+        #pragma omp for schedule(static)
+        for (long i = 0; i < (long) n_records; i++) {
+            const char* record = records + i * record_size;
+            int line_header[TTS_RECORD_HEADER_INTS];
+            memcpy(line_header, record, sizeof(line_header));
+            memcpy(&vals[0], record + sizeof(line_header),
+                   n_pts * sizeof(float));
+            tts(i, 0) = line_header[0];
+            tts(i, 1) = line_header[1];
+            for (unsigned t = 0; t < n_pts; t++) {
+                tts(i, TTS_RECORD_HEADER_INTS + t) = vals[t];
+            }
+        }
+    }
+
+    return(tts);
+}
+
+// Number of elements in the .tpa record header (row, column, number of
+// seasons), and number of seasonal indicators stored for each season
+const unsigned TPA_RECORD_HEADER_INTS = 3;
+const unsigned TPA_NUM_INDICATORS = 11;
+
+// Per-pixel record information from the first pass over a .tpa file
+struct tpa_index {
+    std::vector<size_t> offset;
+    std::vector<int> row;
+    std::vector<int> col;
+    std::vector<int> n_seasons;
+    // Index of the first season of each pixel in the season table
+    std::vector<size_t> first_season;
+    size_t total_seasons;
+    int max_seasons;
+};
+
+// First pass over a .tpa file: walk the variable length records, recording
+// where each pixel's record starts and where its seasons will go in the
+// season table
+static tpa_index index_tpa(const mapped_file& f) {
+    tpa_index idx;
+    idx.total_seasons = 0;
+    idx.max_seasons = 0;
+    size_t pos = TS_HEADER_SIZE;
+    const size_t record_header_size = TPA_RECORD_HEADER_INTS * sizeof(int);
+    while (pos < f.size()) {
+        if (pos + record_header_size > f.size()) {
+            Rcpp::stop("tpa file is truncated");
+        }
+        int line_header[TPA_RECORD_HEADER_INTS];
+        memcpy(line_header, f.data() + pos, record_header_size);
+        if (line_header[2] < 0) {
+            Rcpp::stop("invalid number of seasons in tpa file");
+        }
+        idx.offset.push_back(pos + record_header_size);
+        idx.row.push_back(line_header[0]);
+        idx.col.push_back(line_header[1]);
+        idx.n_seasons.push_back(line_header[2]);
+        idx.first_season.push_back(idx.total_seasons);
+        idx.total_seasons += line_header[2];
+        if (line_header[2] > idx.max_seasons) idx.max_seasons = line_header[2];
+        pos += record_header_size +
+            (size_t) line_header[2] * TPA_NUM_INDICATORS * sizeof(float);
+    }
+    if (pos != f.size()) {
+        Rcpp::stop("tpa file is truncated");
+    }
+    return(idx);
+}
+
+//' Read a TIMESAT .tpa file
+//'
+//' Memory-maps a TIMESAT .tpa (seasonality parameter) file and decodes it in
+//' two passes. The first pass walks the record headers to find the offset of
+//' each pixel's record and the number of seasons it contains, and the second
+//' pass decodes the seasonal indicators (in parallel when OpenMP is
+//' available) directly into a table with one row per season. Pixels with no
+//' seasons do not appear in the output. This function is called by the
+//' \code{\link{tpa2df}} function. It is not intended to be used directly.
+//'
+//' @param filename the .tpa file to read
+//' @param max_num_seasons if greater than zero, an error is raised if any
+//' pixel has more than this number of seasons
+//' @param n_threads number of threads to use (if 0, use the OpenMP default)
+//' @return matrix with one row per season, giving the row and column of the
+//' pixel, the season number, and the 11 seasonal indicators
+// [[Rcpp::export]]
+arma::mat read_tpa(std::string filename, int max_num_seasons=0,
+        int n_threads=0) {
+    mapped_file f(filename);
+    read_timesat_header(f);
+    tpa_index idx = index_tpa(f);
+    if (max_num_seasons > 0 && idx.max_seasons > max_num_seasons) {
+        Rcpp::stop("a pixel has more seasons than max_num_seasons");
+    }
+
+    const unsigned n_out_cols = TPA_RECORD_HEADER_INTS + TPA_NUM_INDICATORS;
+    mat tpa(idx.total_seasons, n_out_cols);
+    long n_pixels = idx.offset.size();
+
+    int n_thr = 1;
+#ifdef _OPENMP
+    n_thr = n_threads > 0 ? n_threads : omp_get_max_threads();
+#endif
+    #pragma omp parallel for schedule(static) num_threads(n_thr)
+    for (long i = 0; i < n_pixels; i++) {
+        float vals[TPA_NUM_INDICATORS];
+        const char* season_data = f.data() + idx.offset[i];
+        for (int s = 0; s < idx.n_seasons[i]; s++) {
+            size_t out_row = idx.first_season[i] + s;
+            memcpy(vals, season_data + s * sizeof(vals), sizeof(vals));
+            tpa(out_row, 0) = idx.row[i];
+            tpa(out_row, 1) = idx.col[i];
+            tpa(out_row, 2) = s + 1;
+            for (unsigned k = 0; k < TPA_NUM_INDICATORS; k++) {
+                tpa(out_row, TPA_RECORD_HEADER_INTS + k) = vals[k];
+            }
+        }
+    }
+
+    return(tpa);
+}
+
+// Byte offset of the start of the record after the one starting at pos, and
+// the number of seasons in the record (always 0 for .tts files)
+static size_t next_record(const mapped_file& f, size_t pos, bool is_tpa,
+        const timesat_header& hdr, int& n_seasons) {
+    n_seasons = 0;
+    if (!is_tpa) return(pos + tts_record_size(hdr));
+    if (pos + TPA_RECORD_HEADER_INTS * sizeof(int) > f.size()) {
+        Rcpp::stop("tpa file is truncated");
+    }
+    memcpy(&n_seasons, f.data() + pos + 2 * sizeof(int), sizeof(int));
+    if (n_seasons < 0) {
+        Rcpp::stop("invalid number of seasons in tpa file");
+    }
+    return(pos + TPA_RECORD_HEADER_INTS * sizeof(int) +
+           (size_t) n_seasons * TPA_NUM_INDICATORS * sizeof(float));
+}
+
+//' Index the records of a TIMESAT file by image row
+//'
+//' Walks the record headers of a memory-mapped TIMESAT .tts or .tpa file
+//' once, and finds the byte offset at which the records for each row of the
+//' image begin. TIMESAT writes its output one image row at a time, so the
+//' records for each row are contiguous - an error is raised if they are not.
+//' The index allows the records for a block of rows to be decoded without
+//' reading the rest of the file. This function is called by the
+//' \code{\link{tts2raster}} and \code{\link{tpa2raster}} functions. It is not
+//' intended to be used directly.
+//'
+//' @param filename the .tts or .tpa file to index
+//' @param n_rows number of rows in the image
+//' @return list with elements "offsets" (the byte offset of the first record
+//' of each row, followed by the offset of the end of the records), "n_pts"
+//' (the number of time points in each .tts record), and "max_seasons" (the
+//' maximum number of seasons of any pixel in a .tpa file)
+// [[Rcpp::export]]
+Rcpp::List index_timesat_rows(std::string filename, int n_rows) {
+    std::string ext = filename.substr(filename.find_last_of(".") + 1);
+    for (unsigned i = 0; i < ext.size(); i++) ext[i] = tolower(ext[i]);
+    bool is_tpa = ext == "tpa";
+    mapped_file f(filename);
+    timesat_header hdr = read_timesat_header(f);
+    if (!is_tpa) tts_record_count(f, hdr);
+
+    Rcpp::NumericVector offsets(n_rows + 1);
+    int max_seasons = 0;
+    int last_row = 0;
+    size_t pos = TS_HEADER_SIZE;
+    while (pos < f.size()) {
+        if (pos + 2 * sizeof(int) > f.size()) {
+            Rcpp::stop("file is truncated");
+        }
+        int row;
+        memcpy(&row, f.data() + pos, sizeof(int));
+        if (row < 1 || row > n_rows) {
+            Rcpp::stop("file contains pixels outside of the output grid");
+        }
+        if (row < last_row) {
+            Rcpp::stop("records are not ordered by row");
+        }
+        // Rows with no records start (and end) where the next row starts
+        for (int r = last_row; r < row; r++) offsets[r] = pos;
+        last_row = row;
+        int n_seasons;
+        pos = next_record(f, pos, is_tpa, hdr, n_seasons);
+        if (n_seasons > max_seasons) max_seasons = n_seasons;
+    }
+    if (pos != f.size()) {
+        Rcpp::stop("file is truncated");
+    }
+    for (int r = last_row; r <= n_rows; r++) offsets[r] = pos;
+
+    return(Rcpp::List::create(Rcpp::Named("offsets")=offsets,
+                              Rcpp::Named("n_pts")=hdr.n_years * hdr.n_pts_per_year,
+                              Rcpp::Named("max_seasons")=max_seasons));
+}
+
+//' Decode a block of rows from a TIMESAT file into a grid
+//'
+//' Decodes the records of a memory-mapped TIMESAT file that lie between two
+//' byte offsets (as found by \code{index_timesat_rows}) directly into the
+//' cells of a block of rows of the output image. For a .tts file, the output
+//' has one column per time point. For a .tpa file, the output has one column
+//' per season, holding the chosen seasonal indicator. This function is called
+//' by the \code{\link{tts2raster}} and \code{\link{tpa2raster}} functions,
+//' once per block of rows. It is not intended to be used directly.
+//'
+//' @param filename the .tts or .tpa file to read
+//' @param start_offset byte offset of the first record in the block
+//' @param end_offset byte offset of the end of the last record in the block
+//' @param first_row the (1 based) first image row in the block
+//' @param n_rows number of rows in the block
+//' @param n_cols number of columns in the image
+//' @param n_bands number of output columns (time points or seasons)
+//' @param indicator for .tpa files, the (1 based) index of the seasonal
+//' indicator to output, in the order start, end, length, base_value,
+//' peak_time, peak_value, amp, left_deriv, right_deriv, large_integ, and
+//' small_integ. Ignored for .tts files.
+//' @return matrix with one row per cell of the block (in row-major order, as
+//' used by the \code{raster} package) and \code{n_bands} columns. Cells with
+//' no value are coded as NA.
+// [[Rcpp::export]]
+arma::mat decode_timesat_block(std::string filename, double start_offset,
+        double end_offset, int first_row, int n_rows, int n_cols, int n_bands,
+        int indicator=1) {
+    std::string ext = filename.substr(filename.find_last_of(".") + 1);
+    for (unsigned i = 0; i < ext.size(); i++) ext[i] = tolower(ext[i]);
+    bool is_tpa = ext == "tpa";
+    if (is_tpa && (indicator < 1 || indicator > (int) TPA_NUM_INDICATORS)) {
+        Rcpp::stop("indicator must be between 1 and 11");
+    }
+    mapped_file f(filename);
+    timesat_header hdr = read_timesat_header(f);
+    if (end_offset > f.size() || start_offset < TS_HEADER_SIZE) {
+        Rcpp::stop("offsets are outside of the file");
+    }
+    unsigned n_pts = hdr.n_years * hdr.n_pts_per_year;
+    if (!is_tpa && (int) n_pts != n_bands) {
+        Rcpp::stop("n_bands does not match the number of time points in the file");
+    }
+
+    mat block((size_t) n_rows * n_cols, n_bands);
+    block.fill(datum::nan);
+    size_t pos = (size_t) start_offset;
+    std::vector<float> vals(is_tpa ? TPA_NUM_INDICATORS : n_pts);
+    while (pos < (size_t) end_offset) {
+        int line_header[2];
+        memcpy(line_header, f.data() + pos, sizeof(line_header));
+        int row = line_header[0] - first_row;
+        int col = line_header[1] - 1;
+        if (row < 0 || row >= n_rows || col < 0 || col >= n_cols) {
+            Rcpp::stop("record is outside of the block");
+        }
+        size_t cell = (size_t) row * n_cols + col;
+        int n_seasons;
+        size_t next_pos = next_record(f, pos, is_tpa, hdr, n_seasons);
+        if (is_tpa) {
+            if (n_seasons > n_bands) {
+                Rcpp::stop("a pixel has more seasons than n_bands");
+            }
+            const char* season_data = f.data() + pos +
+                TPA_RECORD_HEADER_INTS * sizeof(int);
+            for (int s = 0; s < n_seasons; s++) {
+                float val;
+                memcpy(&val, season_data +
+                       (s * TPA_NUM_INDICATORS + indicator - 1) * sizeof(float),
+                       sizeof(float));
+                block(cell, s) = val;
+            }
+        } else {
+            memcpy(&vals[0], f.data() + pos + TTS_RECORD_HEADER_INTS * sizeof(int),
+                   n_pts * sizeof(float));
+            for (unsigned t = 0; t < n_pts; t++) block(cell, t) = vals[t];
+        }
+        pos = next_pos;
+    }
+
+    return(block);
+}
@@ -0,0 +1,454 @@
+#include "window_kernels.h"
+#include <algorithm>
+#include <climits>
+#include <map>
+
+using namespace arma;
+
+static int radius_halo(const window_params& p) {
+    return(p.radius);
+}
+
+static std::vector<std::string> single_output(const window_params& p) {
+    return(std::vector<std::string>(1, ""));
+}
+
+// Focal mean of the non-missing pixels in the window, calculated from
+// running column sums so that the cost per pixel does not depend on the
+// window size
+static void focal_mean(const window_band& band, int first_row, int last_row,
+        int out_row_offset, const window_params& p,
+        std::vector<double*>& out) {
+    int r = p.radius;
+    int n_cols = band.n_cols;
+    std::vector<double> col_sum(n_cols), col_n(n_cols);
+    for (int row = first_row; row <= last_row; row++) {
+        // Sums over the window rows for each column
+        std::fill(col_sum.begin(), col_sum.end(), 0);
+        std::fill(col_n.begin(), col_n.end(), 0);
+        for (int wr = std::max(0, row - r);
+                wr <= std::min(band.n_rows - 1, row + r); wr++) {
+            for (int col = 0; col < n_cols; col++) {
+                double val = band.at(wr, col);
+                if (is_finite(val)) {
+                    col_sum[col] += val;
+                    col_n[col]++;
+                }
+            }
+        }
+        double sum = 0, n = 0;
+        for (int col = 0; col < std::min(r, n_cols); col++) {
+            sum += col_sum[col];
+            n += col_n[col];
+        }
+        double* out_row = out[0] + (size_t) (row - out_row_offset) * n_cols;
+        for (int col = 0; col < n_cols; col++) {
+            if (col + r < n_cols) {
+                sum += col_sum[col + r];
+                n += col_n[col + r];
+            }
+            if (col - r - 1 >= 0) {
+                sum -= col_sum[col - r - 1];
+                n -= col_n[col - r - 1];
+            }
+            out_row[col] = n > 0 ? sum / n : datum::nan;
+        }
+    }
+}
+
+// Collect the non-missing values in the window around a pixel
+static void window_values(const window_band& band, int row, int col, int r,
+        std::vector<double>& vals) {
+    vals.clear();
+    for (int wr = row - r; wr <= row + r; wr++) {
+        for (int wc = col - r; wc <= col + r; wc++) {
+            if (!band.inside(wr, wc)) continue;
+            double val = band.at(wr, wc);
+            if (is_finite(val)) vals.push_back(val);
+        }
+    }
+}
+
+// Focal median of the non-missing pixels in the window (the mean of the two
+// middle values when there are an even number of values, as in R's median),
+// found by sorting the values in each window. Used for bands that are not
+// integer valued.
+static void focal_median_sort(const window_band& band, int first_row,
+        int last_row, int out_row_offset, const window_params& p,
+        std::vector<double*>& out) {
+    std::vector<double> vals;
+    for (int row = first_row; row <= last_row; row++) {
+        double* out_row = out[0] + (size_t) (row - out_row_offset) * band.n_cols;
+        for (int col = 0; col < band.n_cols; col++) {
+            window_values(band, row, col, p.radius, vals);
+            size_t n = vals.size();
+            if (n == 0) {
+                out_row[col] = datum::nan;
+                continue;
+            }
+            std::nth_element(vals.begin(), vals.begin() + n / 2, vals.end());
+            double med = vals[n / 2];
+            if (n % 2 == 0) {
+                med = (med + *std::max_element(vals.begin(),
+                                               vals.begin() + n / 2)) / 2;
+            }
+            out_row[col] = med;
+        }
+    }
+}
+
+// Focal majority (most common value) of the non-missing pixels in the
+// window, found by counting the values in each window. Ties are broken in
+// favor of the smallest value. Used for bands that are not integer valued.
+static void focal_majority_count(const window_band& band, int first_row,
+        int last_row, int out_row_offset, const window_params& p,
+        std::vector<double*>& out) {
+    std::vector<double> vals;
+    std::map<double, int> counts;
+    for (int row = first_row; row <= last_row; row++) {
+        double* out_row = out[0] + (size_t) (row - out_row_offset) * band.n_cols;
+        for (int col = 0; col < band.n_cols; col++) {
+            window_values(band, row, col, p.radius, vals);
+            counts.clear();
+            for (size_t i = 0; i < vals.size(); i++) counts[vals[i]]++;
+            double mode = datum::nan;
+            int mode_count = 0;
+            for (std::map<double, int>::iterator it = counts.begin();
+                    it != counts.end(); it++) {
+                if (it->second > mode_count) {
+                    mode = it->first;
+                    mode_count = it->second;
+                }
+            }
+            out_row[col] = mode;
+        }
+    }
+}
+
+// Largest range of values that the sliding histogram filters will handle.
+// Bands with a larger range (or that are not integer valued) are filtered
+// with the sort and count based versions above.
+const int MAX_HIST_BINS = 1024;
+
+// The sliding histogram filters scan the histogram at every pixel, so they
+// are only faster than sorting the window when the number of bins is small
+// relative to the number of pixels in the window. Integer bands with more
+// than HIST_BINS_PER_PIXEL bins per window pixel are also filtered with the
+// sort and count based versions.
+const int HIST_BINS_PER_PIXEL = 4;
+
+enum {
+    HIST_MEDIAN,
+    HIST_MAJORITY
+};
+
+// Find the range of the values in rows first_row to last_row of a band.
+// Returns false if any value is not an integer, or if the range is too
+// large for a histogram for a window with half-width r.
+static bool integer_range(const window_band& band, int first_row,
+        int last_row, int r, int& min_val, int& n_bins) {
+    double lo = datum::inf, hi = -datum::inf;
+    for (int row = first_row; row <= last_row; row++) {
+        for (int col = 0; col < band.n_cols; col++) {
+            double val = band.at(row, col);
+            if (!is_finite(val)) continue;
+            if (val != floor(val)) return(false);
+            if (val < lo) lo = val;
+            if (val > hi) hi = val;
+        }
+    }
+    if (!is_finite(lo)) {
+        // All values missing
+        min_val = 0;
+        n_bins = 1;
+        return(true);
+    }
+    if (lo < INT_MIN || hi > INT_MAX) return(false);
+    double max_bins = std::min((double) MAX_HIST_BINS,
+                               HIST_BINS_PER_PIXEL * (2.0 * r + 1) * (2.0 * r + 1));
+    if (hi - lo + 1 > max_bins) return(false);
+    min_val = (int) lo;
+    n_bins = (int) (hi - lo) + 1;
+    return(true);
+}
+
+// Median or majority filter using sliding histograms (Perreault and Hebert
+// 2007). A histogram is kept for each column of the window, and is updated
+// by one pixel as the window moves down a row. The window histogram is
+// updated by adding and removing whole column histograms as the window moves
+// along a row, so the cost per pixel depends on the number of distinct
+// values, but not on the window size.
+static void sliding_hist_filter(const window_band& band, int first_row,
+        int last_row, int out_row_offset, int r, int min_val, int n_bins,
+        int mode, std::vector<double*>& out) {
+    int n_cols = band.n_cols;
+    std::vector<unsigned short> col_hist((size_t) n_cols * n_bins, 0);
+    std::vector<int> win_hist(n_bins);
+
+    // Add or remove one pixel from the histogram of its column
+    #define UPDATE_COL_HIST(row, delta) \
+        for (int col = 0; col < n_cols; col++) { \
+            double val = band.at(row, col); \
+            if (is_finite(val)) { \
+                col_hist[(size_t) col * n_bins + (int) val - min_val] += delta; \
+            } \
+        }
+
+    for (int row = std::max(0, first_row - r);
+            row <= std::min(band.n_rows - 1, first_row + r); row++) {
+        UPDATE_COL_HIST(row, 1)
+    }
+    for (int row = first_row; row <= last_row; row++) {
+        if (row > first_row) {
+            if (row - r - 1 >= 0) {
+                UPDATE_COL_HIST(row - r - 1, -1)
+            }
+            if (row + r < band.n_rows) {
+                UPDATE_COL_HIST(row + r, 1)
+            }
+        }
+        std::fill(win_hist.begin(), win_hist.end(), 0);
+        int n = 0;
+        for (int col = 0; col < std::min(r, n_cols); col++) {
+            const unsigned short* h = &col_hist[(size_t) col * n_bins];
+            for (int b = 0; b < n_bins; b++) {
+                win_hist[b] += h[b];
+                n += h[b];
+            }
+        }
+        double* out_row = out[0] + (size_t) (row - out_row_offset) * n_cols;
+        for (int col = 0; col < n_cols; col++) {
+            if (col + r < n_cols) {
+                const unsigned short* h = &col_hist[(size_t) (col + r) * n_bins];
+                for (int b = 0; b < n_bins; b++) {
+                    win_hist[b] += h[b];
+                    n += h[b];
+                }
+            }
+            if (col - r - 1 >= 0) {
+                const unsigned short* h = &col_hist[(size_t) (col - r - 1) * n_bins];
+                for (int b = 0; b < n_bins; b++) {
+                    win_hist[b] -= h[b];
+                    n -= h[b];
+                }
+            }
+            if (n == 0) {
+                out_row[col] = datum::nan;
+            } else if (mode == HIST_MAJORITY) {
+                int mode_bin = 0;
+                for (int b = 1; b < n_bins; b++) {
+                    if (win_hist[b] > win_hist[mode_bin]) mode_bin = b;
+                }
+                out_row[col] = mode_bin + min_val;
+            } else {
+                // Values at (0 based) ranks (n - 1) / 2 and n / 2
+                int lo_rank = (n - 1) / 2, hi_rank = n / 2;
+                int cum = 0, lo_bin = -1, hi_bin = -1;
+                for (int b = 0; b < n_bins; b++) {
+                    cum += win_hist[b];
+                    if (lo_bin < 0 && cum > lo_rank) lo_bin = b;
+                    if (cum > hi_rank) {
+                        hi_bin = b;
+                        break;
+                    }
+                }
+                out_row[col] = (lo_bin + hi_bin) / 2.0 + min_val;
+            }
+        }
+    }
+    #undef UPDATE_COL_HIST
+}
+
+// Focal median of the non-missing pixels in the window (the mean of the two
+// middle values when there are an even number of values, as in R's median)
+static void focal_median(const window_band& band, int first_row,
+        int last_row, int out_row_offset, const window_params& p,
+        std::vector<double*>& out) {
+    int min_val, n_bins;
+    if (integer_range(band, std::max(0, first_row - p.radius),
+                      std::min(band.n_rows - 1, last_row + p.radius),
+                      p.radius, min_val, n_bins)) {
+        sliding_hist_filter(band, first_row, last_row, out_row_offset,
+                            p.radius, min_val, n_bins, HIST_MEDIAN, out);
+    } else {
+        focal_median_sort(band, first_row, last_row, out_row_offset, p, out);
+    }
+}
+
+// Focal majority (most common value) of the non-missing pixels in the
+// window. Ties are broken in favor of the smallest value.
+static void focal_majority(const window_band& band, int first_row,
+        int last_row, int out_row_offset, const window_params& p,
+        std::vector<double*>& out) {
+    int min_val, n_bins;
+    if (integer_range(band, std::max(0, first_row - p.radius),
+                      std::min(band.n_rows - 1, last_row + p.radius),
+                      p.radius, min_val, n_bins)) {
+        sliding_hist_filter(band, first_row, last_row, out_row_offset,
+                            p.radius, min_val, n_bins, HIST_MAJORITY, out);
+    } else {
+        focal_majority_count(band, first_row, last_row, out_row_offset, p,
+                             out);
+    }
+}
+
+static int slope_halo(const window_params& p) {
+    return(1);
+}
+
+// Slope (in radians) using Horn's (1981) method, as in raster::terrain.
+// Pixels on the edge of the image, or next to missing pixels, are coded as
+// NA.
+static void horn_slope(const window_band& band, int first_row, int last_row,
+        int out_row_offset, const window_params& p,
+        std::vector<double*>& out) {
+    for (int row = first_row; row <= last_row; row++) {
+        double* out_row = out[0] + (size_t) (row - out_row_offset) * band.n_cols;
+        for (int col = 0; col < band.n_cols; col++) {
+            if (!band.inside(row - 1, col - 1) ||
+                    !band.inside(row + 1, col + 1)) {
+                out_row[col] = datum::nan;
+                continue;
+            }
+            double a = band.at(row - 1, col - 1);
+            double b = band.at(row - 1, col);
+            double c = band.at(row - 1, col + 1);
+            double d = band.at(row, col - 1);
+            double f = band.at(row, col + 1);
+            double g = band.at(row + 1, col - 1);
+            double h = band.at(row + 1, col);
+            double i = band.at(row + 1, col + 1);
+            double dz_dx = ((c + 2 * f + i) - (a + 2 * d + g)) / (8 * p.res_x);
+            double dz_dy = ((g + 2 * h + i) - (a + 2 * b + c)) / (8 * p.res_y);
+            // NAs propagate through the differences
+            out_row[col] = atan(sqrt(dz_dx * dz_dx + dz_dy * dz_dy));
+        }
+    }
+}
+
+static int glcm_halo(const window_params& p) {
+    return(p.radius + std::max(std::abs(p.shift_row), std::abs(p.shift_col)));
+}
+
+// Statistics calculated by glcm_textures
+static const char* const glcm_statistics[] = {"mean", "variance",
+    "homogeneity", "contrast", "dissimilarity", "entropy", "second_moment",
+    "correlation"};
+static const unsigned n_glcm_statistics =
+    sizeof(glcm_statistics) / sizeof(glcm_statistics[0]);
+
+static std::vector<std::string> glcm_outputs(const window_params& p) {
+    for (unsigned k = 0; k < p.statistics.size(); k++) {
+        bool known = false;
+        for (unsigned m = 0; m < n_glcm_statistics; m++) {
+            if (p.statistics[k] == glcm_statistics[m]) known = true;
+        }
+        if (!known) {
+            Rcpp::stop("unknown glcm statistic \"" + p.statistics[k] + "\"");
+        }
+    }
+    return(p.statistics);
+}
+
+// Quantize a value to a grey level from 1 to n_grey (0 for values that are
+// missing or outside of [min_x, max_x]), matching
+// cut(x, breaks=seq(min_x, max_x, length.out=n_grey + 1), include.lowest=TRUE)
+static int grey_level(double val, const window_params& p) {
+    if (!is_finite(val) || val < p.min_x || val > p.max_x) return(0);
+    int level = (int) ceil((val - p.min_x) / (p.max_x - p.min_x) * p.n_grey);
+    return(std::max(1, std::min(p.n_grey, level)));
+}
+
+// Grey level co-occurrence matrix (GLCM) textures (Haralick et al. 1973).
+// The GLCM for each pixel is built from the pairs of pixels (base, base +
+// shift) with the base pixel in the window. Pixels where the window contains
+// a missing value, or extends past the edge of the image, are coded as NA.
+static void glcm_textures(const window_band& band, int first_row,
+        int last_row, int out_row_offset, const window_params& p,
+        std::vector<double*>& out) {
+    int r = p.radius;
+    int n_grey = p.n_grey;
+    mat P(n_grey, n_grey);
+    unsigned n_stats = p.statistics.size();
+    for (int row = first_row; row <= last_row; row++) {
+        size_t out_first = (size_t) (row - out_row_offset) * band.n_cols;
+        for (int col = 0; col < band.n_cols; col++) {
+            P.zeros();
+            bool valid = true;
+            for (int wr = row - r; valid && wr <= row + r; wr++) {
+                for (int wc = col - r; wc <= col + r; wc++) {
+                    int or_ = wr + p.shift_row;
+                    int oc = wc + p.shift_col;
+                    if (!band.inside(wr, wc) || !band.inside(or_, oc)) {
+                        valid = false;
+                        break;
+                    }
+                    int base = grey_level(band.at(wr, wc), p);
+                    int offset = grey_level(band.at(or_, oc), p);
+                    if (base == 0 || offset == 0) {
+                        valid = false;
+                        break;
+                    }
+                    P(base - 1, offset - 1)++;
+                }
+            }
+            if (!valid) {
+                for (unsigned k = 0; k < n_stats; k++) {
+                    out[k][out_first + col] = datum::nan;
+                }
+                continue;
+            }
+            P /= accu(P);
+            // Means and variances of the base (i) and offset (j) levels
+            double mean_i = 0, mean_j = 0;
+            for (int j = 0; j < n_grey; j++) {
+                for (int i = 0; i < n_grey; i++) {
+                    mean_i += (i + 1) * P(i, j);
+                    mean_j += (j + 1) * P(i, j);
+                }
+            }
+            double var_i = 0, var_j = 0, cov = 0, homogeneity = 0,
+                   contrast = 0, dissimilarity = 0, entropy = 0,
+                   second_moment = 0;
+            for (int j = 0; j < n_grey; j++) {
+                for (int i = 0; i < n_grey; i++) {
+                    double pij = P(i, j);
+                    if (pij == 0) continue;
+                    double di = (i + 1) - mean_i;
+                    double dj = (j + 1) - mean_j;
+                    var_i += di * di * pij;
+                    var_j += dj * dj * pij;
+                    cov += di * dj * pij;
+                    homogeneity += pij / (1 + (i - j) * (i - j));
+                    contrast += (i - j) * (i - j) * pij;
+                    dissimilarity += std::abs(i - j) * pij;
+                    entropy -= pij * log(pij);
+                    second_moment += pij * pij;
+                }
+            }
+            for (unsigned k = 0; k < n_stats; k++) {
+                const std::string& stat = p.statistics[k];
+                double val = datum::nan;
+                if (stat == "mean") val = mean_i;
+                else if (stat == "variance") val = var_i;
+                else if (stat == "homogeneity") val = homogeneity;
+                else if (stat == "contrast") val = contrast;
+                else if (stat == "dissimilarity") val = dissimilarity;
+                else if (stat == "entropy") val = entropy;
+                else if (stat == "second_moment") val = second_moment;
+                else if (stat == "correlation") val = cov / sqrt(var_i * var_j);
+                out[k][out_first + col] = val;
+            }
+        }
+    }
+}
+
+const window_kernel_def window_kernels[] = {
+    {"mean", radius_halo, single_output, focal_mean},
+    {"median", radius_halo, single_output, focal_median},
+    {"majority", radius_halo, single_output, focal_majority},
+    {"slope", slope_halo, single_output, horn_slope},
+    {"glcm", glcm_halo, glcm_outputs, glcm_textures}
+};
+const unsigned n_window_kernels =
+    sizeof(window_kernels) / sizeof(window_kernels[0]);
@@ -0,0 +1,65 @@
+#ifndef TEAMLUCC_WINDOW_KERNELS_H
+#define TEAMLUCC_WINDOW_KERNELS_H
+
+#include <RcppArmadillo.h>
+#include <string>
+#include <vector>
+
+// Parameters shared by the native window kernels run by run_window_kernel.
+// Not every kernel uses every parameter.
+struct window_params {
+    // Half-width of the (square) window, so the window is 2 * radius + 1
+    // pixels on a side
+    int radius;
+    // GLCM parameters: number of grey levels, range of values used for
+    // quantization, the shift between the base and offset pixels (in rows
+    // and columns), and the statistics to calculate
+    int n_grey;
+    double min_x;
+    double max_x;
+    int shift_row;
+    int shift_col;
+    std::vector<std::string> statistics;
+    // Cell size (used by the slope kernel)
+    double res_x;
+    double res_y;
+};
+
+// One band of a block of pixels, stored in row-major order (as returned by
+// raster::getValues), with n_rows x n_cols pixels. Pixels outside of the
+// block are treated as outside of the image.
+struct window_band {
+    const double* vals;
+    int n_rows;
+    int n_cols;
+    double at(int row, int col) const {
+        return(vals[(size_t) row * n_cols + col]);
+    }
+    bool inside(int row, int col) const {
+        return(row >= 0 && row < n_rows && col >= 0 && col < n_cols);
+    }
+};
+
+// A kernel calculates its output for rows first_row to last_row (inclusive,
+// in block coordinates) of one band. out[k] points to the output for
+// statistic k, which is row-major with out_row_offset subtracted from the
+// block row (so that only the core rows of the block are stored).
+typedef void (*window_kernel_fn)(const window_band& band, int first_row,
+        int last_row, int out_row_offset, const window_params& p,
+        std::vector<double*>& out);
+
+struct window_kernel_def {
+    const char* name;
+    // Number of rows (and columns) of context needed on each side of a pixel
+    int (*halo)(const window_params& p);
+    // Names of the output statistics (one output layer per statistic per
+    // input band)
+    std::vector<std::string> (*outputs)(const window_params& p);
+    window_kernel_fn run;
+};
+
+// Registry of the available kernels (defined in window_kernels.cpp)
+extern const window_kernel_def window_kernels[];
+extern const unsigned n_window_kernels;
+
+#endif
@@ -0,0 +1,141 @@
+#include <RcppArmadillo.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "window_kernels.h"
+
+using namespace arma;
+
+// Number of output rows per tile. Tiles (of one band each) are the unit of
+// work shared out between threads.
+const int WINDOW_TILE_ROWS = 16;
+
+static const window_kernel_def& find_kernel(std::string name) {
+    for (unsigned k = 0; k < n_window_kernels; k++) {
+        if (name == window_kernels[k].name) return(window_kernels[k]);
+    }
+    Rcpp::stop("unknown window kernel \"" + name + "\"");
+    // Not reached
+    return(window_kernels[0]);
+}
+
+template <typename T>
+static T param_or(Rcpp::List& params, const char* name, T default_val) {
+    if (params.containsElementNamed(name)) {
+        return(Rcpp::as<T>(params[name]));
+    }
+    return(default_val);
+}
+
+static window_params parse_params(Rcpp::List params) {
+    window_params p;
+    p.radius = param_or<int>(params, "radius", 1);
+    p.n_grey = param_or<int>(params, "n_grey", 32);
+    p.min_x = param_or<double>(params, "min_x", datum::nan);
+    p.max_x = param_or<double>(params, "max_x", datum::nan);
+    std::vector<int> shift = param_or<std::vector<int> >(params, "shift",
+            std::vector<int>(2, 1));
+    if (shift.size() != 2) {
+        Rcpp::stop("shift must be a length 2 vector of (row, column) shifts");
+    }
+    p.shift_row = shift[0];
+    p.shift_col = shift[1];
+    const char* default_stats[] = {"mean", "variance", "homogeneity",
+        "contrast", "dissimilarity", "entropy", "second_moment",
+        "correlation"};
+    p.statistics = param_or<std::vector<std::string> >(params, "statistics",
+            std::vector<std::string>(default_stats, default_stats + 8));
+    p.res_x = param_or<double>(params, "res_x", 1);
+    p.res_y = param_or<double>(params, "res_y", 1);
+    if (p.radius < 0) {
+        Rcpp::stop("radius must be zero or greater");
+    }
+    if (p.n_grey < 1) {
+        Rcpp::stop("n_grey must be at least 1");
+    }
+    return(p);
+}
+
+//' Get information on a native window kernel
+//'
+//' Looks up a kernel in the registry of native window kernels used by
+//' \code{\link{apply_windowed}}, and returns the number of rows of context
+//' the kernel needs on each side of a pixel, and the names of its outputs.
+//' This function is called by the \code{\link{apply_windowed}} function. It
+//' is not intended to be used directly.
+//'
+//' @param kernel the name of the kernel
+//' @param params list of kernel parameters (see \code{\link{apply_windowed}})
+//' @return list with elements "halo" and "outputs"
+// [[Rcpp::export]]
+Rcpp::List window_kernel_info(std::string kernel, Rcpp::List params) {
+    const window_kernel_def& def = find_kernel(kernel);
+    window_params p = parse_params(params);
+    return(Rcpp::List::create(Rcpp::Named("halo")=def.halo(p),
+                              Rcpp::Named("outputs")=def.outputs(p)));
+}
+
+//' Run a native window kernel over a block of pixels
+//'
+//' Runs one of the registered native window kernels over a block of an image
+//' that includes the rows of context (the halo) needed above and below the
+//' rows that are to be output. The output rows of each band are split into
+//' tiles that are processed in parallel when OpenMP is available. This
+//' function is called by the \code{\link{apply_windowed}} function, once per
+//' block of pixels. It is not intended to be used directly.
+//'
+//' @param block the block of pixels as a matrix, with pixels (in row-major
+//' order) in rows and bands in columns
+//' @param n_rows number of rows in the block
+//' @param n_cols number of columns in the block
+//' @param first_row the first (0 based) row of the block to output
+//' @param n_out_rows number of rows to output
+//' @param kernel the name of the kernel
+//' @param params list of kernel parameters (see \code{\link{apply_windowed}})
+//' @param n_threads number of threads to use (if 0, use the OpenMP default)
+//' @return matrix with one row per output pixel (in row-major order), and one
+//' column per kernel output per band (with the outputs for the first band
+//' first)
+// [[Rcpp::export]]
+arma::mat run_window_kernel(arma::mat& block, int n_rows, int n_cols,
+        int first_row, int n_out_rows, std::string kernel, Rcpp::List params,
+        int n_threads=0) {
+    if ((int) block.n_rows != n_rows * n_cols) {
+        Rcpp::stop("block must have n_rows * n_cols rows");
+    }
+    if (first_row < 0 || n_out_rows < 0 || first_row + n_out_rows > n_rows) {
+        Rcpp::stop("output rows must be within the block");
+    }
+    const window_kernel_def& def = find_kernel(kernel);
+    window_params p = parse_params(params);
+    unsigned n_bands = block.n_cols;
+    unsigned n_outputs = def.outputs(p).size();
+
+    mat out((size_t) n_out_rows * n_cols, n_bands * n_outputs);
+    int n_tiles = (n_out_rows + WINDOW_TILE_ROWS - 1) / WINDOW_TILE_ROWS;
+    int n_tasks = n_tiles * n_bands;
+
+    int n_thr = 1;
+#ifdef _OPENMP
+    n_thr = n_threads > 0 ? n_threads : omp_get_max_threads();
+#endif
+    #pragma omp parallel for schedule(dynamic) num_threads(n_thr)
+    for (int task = 0; task < n_tasks; task++) {
+        unsigned band_num = task / n_tiles;
+        int tile = task % n_tiles;
+        window_band band;
+        band.vals = block.colptr(band_num);
+        band.n_rows = n_rows;
+        band.n_cols = n_cols;
+        int tile_first = first_row + tile * WINDOW_TILE_ROWS;
+        int tile_last = std::min(tile_first + WINDOW_TILE_ROWS,
+                                 first_row + n_out_rows) - 1;
+        std::vector<double*> out_cols(n_outputs);
+        for (unsigned k = 0; k < n_outputs; k++) {
+            out_cols[k] = out.colptr(band_num * n_outputs + k);
+        }
+        def.run(band, tile_first, tile_last, first_row, p, out_cols);
+    }
+
+    return(out);
+}